@@ -1,295 +1,473 @@
-#include "pch.h"
-#include "dx11.h"
-#include "rayTracer.cpp"
-
-struct CbObject
-{
-	XMMATRIX m_world;
-	XMMATRIX m_view;
-	XMMATRIX m_proj;
-	XMMATRIX m_worldViewProj;
-};
-
-struct Vertex
-{
-	XMFLOAT3 pos;
-	XMFLOAT4 color;
-};
-
-class App : public DX11
-{
-public:
-	App(HINSTANCE instance) : DX11(instance)
-	{
-		m_currentCirclePosX = 0.0f;
-		m_currentCirclePosY = 0.0f;
-	};
-
-	void onInit() override;
-	void onRender() override;
-	void onInput() override;
-	void onUpdate() override;
-
-public:
-	void createLines();
-private:
-	// Buffers
-	ID3D11Buffer *m_vertexBuffer;
-	UINT m_numVertices;
-	ID3D11Buffer *m_indexBuffer;
-	UINT m_numIndices;
-
-	// Constant buffers
-	ID3D11Buffer *cbObjectBuffer;
-
-	// Circle
-	float m_currentCirclePosX;
-	float m_currentCirclePosY;
-
-	// Walls
-	std::vector<Line> walls;
-};
-
-void App::createLines()
-{
-	Circle c(Vector3D(0.0f, 0.0f, 0.0f), 1.0f);
-	c.placePoints(100);
-	
-	Line l1(Vector3D(10.0f, -7.0f, 0.0f), Vector3D(10.0f, 7.0f, 0.0f));
-	Line l2(Vector3D(10.0f, -7.0f, 0.0f), Vector3D(-10.0f, -7.0f, 0.0f));
-	Line l3(Vector3D(10.0f, 7.0f, 0.0f), Vector3D(-10.0f, 7.0f, 0.0f));
-	Line l4(Vector3D(-10.0f, -7.0f, 0.0f), Vector3D(-10.0f, 7.0f, 0.0f));
-
-	Line l5(Vector3D(15.0f, 7.0f, 0.0f), Vector3D(15.0f, -7.0f, 0.0f));
-	Line l6(Vector3D(15.0f, -7.0f, 0.0f), Vector3D(-15.0f, -18.0f, 0.0f));
-
-	Line l7(Vector3D(10.0f, 20.0f, 0.0f), Vector3D(100.0f, 40.0f, 0.0f));
-	Line l8(Vector3D(5.0f, 20.0f, 0.0f), Vector3D(-100.0f, 40.0f, 0.0f));
-
-	Line l9(Vector3D(10.0f, -20.0f, 0.0f), Vector3D(100.0f, -40.0f, 0.0f));
-	Line l10(Vector3D(5.0f, -20.0f, 0.0f), Vector3D(-100.0f, -40.0f, 0.0f));
-	walls.push_back(l1);
-	walls.push_back(l2);
-	walls.push_back(l3);
-	walls.push_back(l4);
-	walls.push_back(l5);
-	walls.push_back(l6);
-	walls.push_back(l7);
-	walls.push_back(l8);
-	walls.push_back(l9);
-	walls.push_back(l10);
-
-	std::vector<Line> wallsToDraw;
-	c.intersectPoints(walls, wallsToDraw);
-	
-	std::vector<Vertex> vertices;
-	std::vector<UINT> indices;
-
-	UINT numLines = c.circleLines.size();
-	UINT numAddLines = walls.size();
-
-	for (int i = 0; i < wallsToDraw.size(); i++)
-	{
-		Line wallToDraw = wallsToDraw[i];
-		XMFLOAT3 f;
-		f.x = wallToDraw.m_p1.x;
-		f.y = wallToDraw.m_p1.y;
-		f.z = 0.0f;
-		vertices.push_back(Vertex{ f, (XMFLOAT4)Colors::White });
-
-		f.x = wallToDraw.m_p2.x;
-		f.y = wallToDraw.m_p2.y;
-		vertices.push_back(Vertex{ f, (XMFLOAT4)Colors::White });
-	}
-
-	for (int i = 0; i < numLines; i++)
-	{
-		XMFLOAT3 f;
-		f.x = c.circleLines[i].m_p1.x;
-		f.y = c.circleLines[i].m_p1.y;
-		f.z = 0.0f;
-		vertices.push_back(Vertex{ f, (XMFLOAT4)Colors::White });
-
-		f.x = c.circleLines[i].m_p2.x;
-		f.y = c.circleLines[i].m_p2.y;
-		vertices.push_back(Vertex{ f, (XMFLOAT4)Colors::White });
-	}
-
-	m_numVertices = numLines * 2 + numAddLines * 2;
-	m_numIndices = m_numVertices * 2;
-
-	for (int i = 0; i < m_numIndices; i++)
-	{
-		indices.push_back(i);
-	}
-
-	// Vertex buffer
-	D3D11_BUFFER_DESC bd;
-	ZeroMemory(&bd, sizeof(bd));
-	bd.Usage = D3D11_USAGE_DEFAULT;
-	bd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-	bd.ByteWidth = sizeof(Vertex) * m_numVertices;
-	bd.CPUAccessFlags = 0;
-
-	D3D11_SUBRESOURCE_DATA initData;
-	ZeroMemory(&initData, sizeof(initData));
-	initData.pSysMem = &vertices[0];
-
-	DX::ThrowIfFailed(m_device->CreateBuffer(&bd, &initData, &m_vertexBuffer));
-
-	// Set vertex buffer
-	UINT stride = sizeof(Vertex);
-	UINT offset = 0;
-	m_deviceContext->IASetVertexBuffers(0, 1, &m_vertexBuffer, &stride, &offset);
-
-	m_deviceContext->UpdateSubresource(m_vertexBuffer, 0, nullptr, &vertices[0], 0, 0);
-
-	// Index buffer
-	bd.Usage = D3D11_USAGE_DEFAULT;
-	bd.BindFlags = D3D11_BIND_INDEX_BUFFER;
-	bd.ByteWidth = sizeof(UINT) * m_numIndices;
-	bd.CPUAccessFlags = 0;
-
-	initData.pSysMem = &indices[0];
-
-	DX::ThrowIfFailed(m_device->CreateBuffer(&bd, &initData, &m_indexBuffer));
-
-	// Set index buffer
-	m_deviceContext->IASetIndexBuffer(m_indexBuffer, DXGI_FORMAT_R32_UINT, 0);
-}
-
-void App::onInit()
-{
-	DX11::onInit();
-
-	// Input layout
-	D3D11_INPUT_ELEMENT_DESC vertexDesc[] = 
-	{
-		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-		{ "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 }
-	};
-
-	UINT numElements = ARRAYSIZE(vertexDesc);
-	DX::ThrowIfFailed(m_device->CreateInputLayout(vertexDesc, numElements, m_vertexShaderBlob->GetBufferPointer(), m_vertexShaderBlob->GetBufferSize(), &m_inputLayout));
-
-	// Set input layout
-	m_deviceContext->IASetInputLayout(m_inputLayout);
-
-	// Set primitive topology
-	m_deviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_LINELIST);
-
-	// Vertex buffer, index buffer
-	createLines();
-
-	// Constant buffers
-	D3D11_BUFFER_DESC bd;
-	ZeroMemory(&bd, sizeof(bd));
-	bd.Usage = D3D11_USAGE_IMMUTABLE;
-	bd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-	bd.ByteWidth = sizeof(CbObject);
-	bd.CPUAccessFlags = 0;
-	
-	XMVECTOR eye = { 0.0f, 0.0f, -40.0f, 0.0f }; // TODO: make smooth zoom and out
-	XMVECTOR at = { 0.0f, 0.0f, 0.0f, 0.0f };
-	XMVECTOR up = { 0.0f, 1.0f, 0.0f, 0.0f };
-	m_view = XMMatrixLookAtLH(eye, at, up);
-
-	m_proj = XMMatrixPerspectiveFovLH(XM_PIDIV2, m_width / (FLOAT)m_height, 0.01f, 1025.0f);
-
-	CbObject cb;
-	cb.m_world = XMMatrixTranspose(m_world);
-	cb.m_view = XMMatrixTranspose(m_view);
-	cb.m_proj = XMMatrixTranspose(m_proj);
-	cb.m_worldViewProj = XMMatrixTranspose(m_world * m_view * m_proj);
-
-	D3D11_SUBRESOURCE_DATA initData;
-	ZeroMemory(&initData, sizeof(initData));
-	initData.pSysMem = &cb;
-	DX::ThrowIfFailed(m_device->CreateBuffer(&bd, &initData, &cbObjectBuffer));
-}
-
-void App::onInput()
-{
-	if (GetKeyState(VK_RIGHT) & 0x8000)
-	{
-		m_currentCirclePosX += 0.7f;
-	}
-	else if (GetKeyState(VK_LEFT) & 0x8000)
-	{
-		m_currentCirclePosX -= 0.7f;
-	}
-	else if (GetKeyState(VK_UP) & 0x8000)
-	{
-		m_currentCirclePosY += 0.7f;
-	}
-	else if (GetKeyState(VK_DOWN) & 0x8000)
-	{
-		m_currentCirclePosY -= 0.7f;
-	}
-}
-
-void App::onUpdate()
-{
-	Circle c(Vector3D(m_currentCirclePosX, m_currentCirclePosY, 0.0f), 1.0f);
-	c.placePoints(100);
-
-	std::vector<Line> wallsToDraw;
-	c.intersectPoints(walls, wallsToDraw);
-
-	UINT numLines = c.circleLines.size();
-
-	std::vector<Vertex> vertices;
-	for (int i = 0; i < wallsToDraw.size(); i++)
-	{
-		Line wallToDraw = wallsToDraw[i];
-
-		XMFLOAT3 f;
-		f.x = wallToDraw.m_p1.x;
-		f.y = wallToDraw.m_p1.y;
-		f.z = 0.0f;
-		vertices.push_back(Vertex{ f, (XMFLOAT4)Colors::White });
-
-		f.x = wallToDraw.m_p2.x;
-		f.y = wallToDraw.m_p2.y;
-		vertices.push_back(Vertex{ f, (XMFLOAT4)Colors::White });
-	}
-
-	for (int i = 0; i < numLines; i++)
-	{
-		XMFLOAT3 f;
-		f.x = c.circleLines[i].m_p1.x;
-		f.y = c.circleLines[i].m_p1.y;
-		f.z = 0.0f;
-		vertices.push_back(Vertex{ f, (XMFLOAT4)Colors::White });
-
-		f.x = c.circleLines[i].m_p2.x;
-		f.y = c.circleLines[i].m_p2.y;
-		vertices.push_back(Vertex{ f, (XMFLOAT4)Colors::White });
-	}
-	
-	// Update vertex buffer
-	m_deviceContext->UpdateSubresource(m_vertexBuffer, 0, nullptr, &vertices[0], 0, 0);
-}
-
-void App::onRender()
-{
-	m_deviceContext->ClearRenderTargetView(m_renderTargetView, Colors::Black);
- 	m_deviceContext->ClearDepthStencilView(m_depthStencilView, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
-
-	m_deviceContext->VSSetShader(m_vertexShader, nullptr, 0);
-	m_deviceContext->VSSetConstantBuffers(0, 1, &cbObjectBuffer);
-	m_deviceContext->PSSetShader(m_pixelShader, nullptr, 0);
-
-	m_deviceContext->DrawIndexed(m_numIndices, 0, 0);
-
-	DX::ThrowIfFailed(m_swapChain->Present(0, 0));
-}
-
-int WINAPI wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _In_ LPWSTR lpCmdLine, _In_ int nCmdShow)
-{
-	App app(hInstance);
-	app.onInit();
-	app.run();
-
-	return 0;
-}
+#include "pch.h"
+#include "dx11.h"
+#include "rayTracer.cpp"
+#include "dirtyRanges.cpp"
+#include "collision.cpp"
+#include "scenePreprocess.cpp"
+#include "progressiveVisibility.cpp"
+
+struct CbObject
+{
+	XMMATRIX m_world;
+	XMMATRIX m_view;
+	XMMATRIX m_proj;
+	XMMATRIX m_worldViewProj;
+};
+
+struct CbDraw
+{
+	XMFLOAT4 m_color;
+};
+
+// Lines are flat, so only x and y go to the GPU; colour comes from CbDraw
+struct Vertex
+{
+	XMFLOAT2 pos;
+};
+
+class App : public DX11
+{
+public:
+	App(HINSTANCE instance) : DX11(instance)
+	{
+		m_currentCirclePosX = 0.0f;
+		m_currentCirclePosY = 0.0f;
+		m_cameraX = 0.0f;
+		m_cameraY = 0.0f;
+		m_cameraDistance = 40.0f;
+		m_targetCameraX = 0.0f;
+		m_targetCameraY = 0.0f;
+		m_targetCameraDistance = 40.0f;
+		m_visibilityBudget = 2000.0;
+	};
+
+	void onInit() override;
+	void onRender() override;
+	void onInput() override;
+	void onUpdate() override;
+
+public:
+	void createLines();
+	void fillVertices(const Circle &c, const std::vector<int> &rays, const std::vector<int> &litWalls, std::vector<int> &items);
+	void updateCamera();
+	void viewRect(Vector3D &min, Vector3D &max) const;
+private:
+	// Buffers. The fan takes the first two vertices per ray, then every wall
+	// has a fixed pair, degenerate while it is not lit.
+	ID3D11Buffer *m_vertexBuffer;
+	UINT m_numVertices;
+	UINT m_numRays;
+	std::vector<Vertex> m_vertices;
+	DirtyRangeTracker<Vertex> m_vertexRanges;
+	ID3D11Buffer *m_indexBuffer;
+	UINT m_numIndices;
+
+	// Constant buffers
+	ID3D11Buffer *cbObjectBuffer;
+	ID3D11Buffer *cbDrawBuffer;
+
+	// Circle
+	float m_currentCirclePosX;
+	float m_currentCirclePosY;
+
+	// Camera, eased towards the target every update
+	float m_cameraX;
+	float m_cameraY;
+	float m_cameraDistance;
+	float m_targetCameraX;
+	float m_targetCameraY;
+	float m_targetCameraDistance;
+
+	// Walls
+	std::vector<Line> walls;
+	OccluderScene m_occluders;
+	OccluderGrid m_occluderGrid;
+
+	// Visibility, refined within m_visibilityBudget microseconds per update
+	ProgressiveVisibility m_visibility;
+	double m_visibilityBudget;
+};
+
+void App::createLines()
+{
+	Circle c(Vector3D(0.0f, 0.0f, 0.0f), 1.0f);
+	c.placePoints(100);
+	
+	Line l1(Vector3D(10.0f, -7.0f, 0.0f), Vector3D(10.0f, 7.0f, 0.0f));
+	Line l2(Vector3D(10.0f, -7.0f, 0.0f), Vector3D(-10.0f, -7.0f, 0.0f));
+	Line l3(Vector3D(10.0f, 7.0f, 0.0f), Vector3D(-10.0f, 7.0f, 0.0f));
+	Line l4(Vector3D(-10.0f, -7.0f, 0.0f), Vector3D(-10.0f, 7.0f, 0.0f));
+
+	Line l5(Vector3D(15.0f, 7.0f, 0.0f), Vector3D(15.0f, -7.0f, 0.0f));
+	Line l6(Vector3D(15.0f, -7.0f, 0.0f), Vector3D(-15.0f, -18.0f, 0.0f));
+
+	Line l7(Vector3D(10.0f, 20.0f, 0.0f), Vector3D(100.0f, 40.0f, 0.0f));
+	Line l8(Vector3D(5.0f, 20.0f, 0.0f), Vector3D(-100.0f, 40.0f, 0.0f));
+
+	Line l9(Vector3D(10.0f, -20.0f, 0.0f), Vector3D(100.0f, -40.0f, 0.0f));
+	Line l10(Vector3D(5.0f, -20.0f, 0.0f), Vector3D(-100.0f, -40.0f, 0.0f));
+	walls.push_back(l1);
+	walls.push_back(l2);
+	walls.push_back(l3);
+	walls.push_back(l4);
+	walls.push_back(l5);
+	walls.push_back(l6);
+	walls.push_back(l7);
+	walls.push_back(l8);
+	walls.push_back(l9);
+	walls.push_back(l10);
+
+	ScenePreprocessor preprocessor;
+	preprocessor.process(walls);
+
+	m_occluders.lines = walls;
+	m_occluderGrid.build(m_occluders);
+
+	UINT numLines = c.circleLines.size();
+	UINT numAddLines = walls.size();
+
+	m_visibility.numRays = numLines;
+	m_visibility.setGrid(m_occluderGrid);
+
+	m_numRays = numLines;
+	m_numVertices = numLines * 2 + numAddLines * 2;
+	m_numIndices = m_numVertices * 2;
+
+	// Filled by the first update, which reports every ray as changed
+	m_vertices.assign(m_numVertices, Vertex{ XMFLOAT2(0.0f, 0.0f) });
+	m_vertexRanges.update(m_vertices, 2);
+
+	std::vector<UINT> indices;
+	for (int i = 0; i < m_numIndices; i++)
+	{
+		indices.push_back(i);
+	}
+
+	// Vertex buffer
+	D3D11_BUFFER_DESC bd;
+	ZeroMemory(&bd, sizeof(bd));
+	bd.Usage = D3D11_USAGE_DEFAULT;
+	bd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	bd.ByteWidth = sizeof(Vertex) * m_numVertices;
+	bd.CPUAccessFlags = 0;
+
+	D3D11_SUBRESOURCE_DATA initData;
+	ZeroMemory(&initData, sizeof(initData));
+	initData.pSysMem = &m_vertices[0];
+
+	DX::ThrowIfFailed(m_device->CreateBuffer(&bd, &initData, &m_vertexBuffer));
+
+	// Set vertex buffer
+	UINT stride = sizeof(Vertex);
+	UINT offset = 0;
+	m_deviceContext->IASetVertexBuffers(0, 1, &m_vertexBuffer, &stride, &offset);
+
+	m_deviceContext->UpdateSubresource(m_vertexBuffer, 0, nullptr, &m_vertices[0], 0, 0);
+
+	// Index buffer
+	bd.Usage = D3D11_USAGE_DEFAULT;
+	bd.BindFlags = D3D11_BIND_INDEX_BUFFER;
+	bd.ByteWidth = sizeof(UINT) * m_numIndices;
+	bd.CPUAccessFlags = 0;
+
+	initData.pSysMem = &indices[0];
+
+	DX::ThrowIfFailed(m_device->CreateBuffer(&bd, &initData, &m_indexBuffer));
+
+	// Set index buffer
+	m_deviceContext->IASetIndexBuffer(m_indexBuffer, DXGI_FORMAT_R32_UINT, 0);
+}
+
+// Rewrites only the given rays of the fan c and the given walls, and lists
+// the vertex pairs it touched in items
+void App::fillVertices(const Circle &c, const std::vector<int> &rays, const std::vector<int> &litWalls, std::vector<int> &items)
+{
+	items.clear();
+
+	for (int i = 0; i < rays.size(); i++)
+	{
+		int ray = rays[i];
+		if (ray >= c.circleLines.size() || ray >= m_numRays)
+		{
+			continue;
+		}
+
+		const Line &l = c.circleLines[ray];
+		m_vertices[ray * 2].pos = XMFLOAT2(l.m_p1.x, l.m_p1.y);
+		m_vertices[ray * 2 + 1].pos = XMFLOAT2(l.m_p2.x, l.m_p2.y);
+		items.push_back(ray);
+	}
+
+	if (litWalls.empty())
+	{
+		return;
+	}
+
+	std::vector<int> wallIndices;
+	std::vector<Line> spans;
+	m_visibility.litWalls(0, wallIndices, spans);
+
+	UINT numWalls = (m_numVertices - m_numRays * 2) / 2;
+	for (int i = 0; i < litWalls.size(); i++)
+	{
+		int wall = litWalls[i];
+		if (wall >= numWalls)
+		{
+			continue;
+		}
+
+		// Dark walls collapse to a point
+		Line span;
+		span.m_p1 = Vector3D(0.0f, 0.0f, 0.0f);
+		span.m_p2 = Vector3D(0.0f, 0.0f, 0.0f);
+		auto it = std::lower_bound(wallIndices.begin(), wallIndices.end(), wall);
+		if (it != wallIndices.end() && *it == wall)
+		{
+			span = spans[it - wallIndices.begin()];
+		}
+
+		int item = m_numRays + wall;
+		m_vertices[item * 2].pos = XMFLOAT2(span.m_p1.x, span.m_p1.y);
+		m_vertices[item * 2 + 1].pos = XMFLOAT2(span.m_p2.x, span.m_p2.y);
+		items.push_back(item);
+	}
+}
+
+void App::onInit()
+{
+	DX11::onInit();
+
+	// Input layout
+	D3D11_INPUT_ELEMENT_DESC vertexDesc[] = 
+	{
+		{ "POSITION", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 }
+	};
+
+	UINT numElements = ARRAYSIZE(vertexDesc);
+	DX::ThrowIfFailed(m_device->CreateInputLayout(vertexDesc, numElements, m_vertexShaderBlob->GetBufferPointer(), m_vertexShaderBlob->GetBufferSize(), &m_inputLayout));
+
+	// Set input layout
+	m_deviceContext->IASetInputLayout(m_inputLayout);
+
+	// Set primitive topology
+	m_deviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_LINELIST);
+
+	// Vertex buffer, index buffer
+	createLines();
+
+	// Constant buffers, the camera one is rewritten whenever the camera moves
+	D3D11_BUFFER_DESC bd;
+	ZeroMemory(&bd, sizeof(bd));
+	bd.Usage = D3D11_USAGE_DEFAULT;
+	bd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	bd.ByteWidth = sizeof(CbObject);
+	bd.CPUAccessFlags = 0;
+	DX::ThrowIfFailed(m_device->CreateBuffer(&bd, nullptr, &cbObjectBuffer));
+
+	m_proj = XMMatrixPerspectiveFovLH(XM_PIDIV2, m_width / (FLOAT)m_height, 0.01f, 1025.0f);
+	updateCamera();
+
+	// Per-draw colour
+	bd.ByteWidth = sizeof(CbDraw);
+
+	CbDraw cbDraw;
+	XMStoreFloat4(&cbDraw.m_color, Colors::White);
+
+	D3D11_SUBRESOURCE_DATA initData;
+	ZeroMemory(&initData, sizeof(initData));
+	initData.pSysMem = &cbDraw;
+	DX::ThrowIfFailed(m_device->CreateBuffer(&bd, &initData, &cbDrawBuffer));
+}
+
+void App::updateCamera()
+{
+	XMVECTOR eye = { m_cameraX, m_cameraY, -m_cameraDistance, 0.0f };
+	XMVECTOR at = { m_cameraX, m_cameraY, 0.0f, 0.0f };
+	XMVECTOR up = { 0.0f, 1.0f, 0.0f, 0.0f };
+	m_view = XMMatrixLookAtLH(eye, at, up);
+
+	CbObject cb;
+	cb.m_world = XMMatrixTranspose(m_world);
+	cb.m_view = XMMatrixTranspose(m_view);
+	cb.m_proj = XMMatrixTranspose(m_proj);
+	cb.m_worldViewProj = XMMatrixTranspose(m_world * m_view * m_proj);
+
+	m_deviceContext->UpdateSubresource(cbObjectBuffer, 0, nullptr, &cb, 0, 0);
+}
+
+// The part of the z = 0 plane on screen, from the screen corners unprojected
+// through m_view and m_proj
+void App::viewRect(Vector3D &min, Vector3D &max) const
+{
+	XMMATRIX inverse = XMMatrixInverse(nullptr, m_world * m_view * m_proj);
+
+	min = Vector3D(INFINITY, INFINITY, 0.0f);
+	max = Vector3D(-INFINITY, -INFINITY, 0.0f);
+	for (int i = 0; i < 4; i++)
+	{
+		float x = (i & 1) ? 1.0f : -1.0f;
+		float y = (i & 2) ? 1.0f : -1.0f;
+
+		XMVECTOR nearPoint = XMVector3TransformCoord(XMVectorSet(x, y, 0.0f, 1.0f), inverse);
+		XMVECTOR farPoint = XMVector3TransformCoord(XMVectorSet(x, y, 1.0f, 1.0f), inverse);
+
+		float nearZ = XMVectorGetZ(nearPoint);
+		float farZ = XMVectorGetZ(farPoint);
+		XMVECTOR p = XMVectorLerp(nearPoint, farPoint, nearZ / (nearZ - farZ));
+
+		min.x = std::min(min.x, XMVectorGetX(p));
+		min.y = std::min(min.y, XMVectorGetY(p));
+		max.x = std::max(max.x, XMVectorGetX(p));
+		max.y = std::max(max.y, XMVectorGetY(p));
+	}
+}
+
+void App::onInput()
+{
+	// Zoom with Q and E, pan with WASD at a speed that follows the zoom
+	if (GetKeyState('Q') & 0x8000)
+	{
+		m_targetCameraDistance = std::max(5.0f, m_targetCameraDistance * 0.97f);
+	}
+	else if (GetKeyState('E') & 0x8000)
+	{
+		m_targetCameraDistance = std::min(1000.0f, m_targetCameraDistance * 1.03f);
+	}
+
+	float panSpeed = m_targetCameraDistance * 0.02f;
+	if (GetKeyState('D') & 0x8000)
+	{
+		m_targetCameraX += panSpeed;
+	}
+	else if (GetKeyState('A') & 0x8000)
+	{
+		m_targetCameraX -= panSpeed;
+	}
+
+	if (GetKeyState('W') & 0x8000)
+	{
+		m_targetCameraY += panSpeed;
+	}
+	else if (GetKeyState('S') & 0x8000)
+	{
+		m_targetCameraY -= panSpeed;
+	}
+
+	Vector3D delta(0.0f, 0.0f, 0.0f);
+	if (GetKeyState(VK_RIGHT) & 0x8000)
+	{
+		delta.x = 0.7f;
+	}
+	else if (GetKeyState(VK_LEFT) & 0x8000)
+	{
+		delta.x = -0.7f;
+	}
+	else if (GetKeyState(VK_UP) & 0x8000)
+	{
+		delta.y = 0.7f;
+	}
+	else if (GetKeyState(VK_DOWN) & 0x8000)
+	{
+		delta.y = -0.7f;
+	}
+
+	if (delta.x == 0.0f && delta.y == 0.0f)
+	{
+		return;
+	}
+
+	// Same radius as the emitter circle in onUpdate
+	Vector3D pos = SweptCircle::move(m_occluderGrid, Vector3D(m_currentCirclePosX, m_currentCirclePosY, 0.0f), 1.0f, delta);
+	m_currentCirclePosX = pos.x;
+	m_currentCirclePosY = pos.y;
+}
+
+void App::onUpdate()
+{
+	// Ease the camera a fixed fraction of the way each update
+	float dx = m_targetCameraX - m_cameraX;
+	float dy = m_targetCameraY - m_cameraY;
+	float dz = m_targetCameraDistance - m_cameraDistance;
+	if (dx != 0.0f || dy != 0.0f || dz != 0.0f)
+	{
+		if (fabs(dx) + fabs(dy) + fabs(dz) < 1e-3f)
+		{
+			m_cameraX = m_targetCameraX;
+			m_cameraY = m_targetCameraY;
+			m_cameraDistance = m_targetCameraDistance;
+		}
+		else
+		{
+			m_cameraX += dx * 0.15f;
+			m_cameraY += dy * 0.15f;
+			m_cameraDistance += dz * 0.15f;
+		}
+		updateCamera();
+	}
+
+	// Emitters off screen are skipped and rays stop past the view, so a
+	// zoomed in view costs less
+	Vector3D viewMin, viewMax;
+	viewRect(viewMin, viewMax);
+	m_visibility.setView(viewMin, viewMax);
+
+	Vector3D pos(m_currentCirclePosX, m_currentCirclePosY, 0.0f);
+
+	// Unfinished refinement carries over to the next update
+	m_visibility.setEmitter(0, pos);
+	m_visibility.update(m_visibilityBudget);
+
+	// Only the rays and walls the visibility pass reports as changed
+	std::vector<int> rays;
+	std::vector<int> litWalls;
+	m_visibility.takeChanges(0, rays, litWalls);
+	if (rays.empty() && litWalls.empty())
+	{
+		return;
+	}
+
+	Circle c(pos, 1.0f);
+	m_visibility.fanLines(0, c.r, c.circleLines);
+
+	std::vector<int> items;
+	fillVertices(c, rays, litWalls, items);
+
+	// Update only the parts of the vertex buffer that changed
+	const std::vector<DirtyRange> &ranges = m_vertexRanges.update(m_vertices, items, 2);
+	for (int i = 0; i < ranges.size(); i++)
+	{
+		D3D11_BOX box;
+		box.left = ranges[i].first * sizeof(Vertex);
+		box.right = (ranges[i].first + ranges[i].count) * sizeof(Vertex);
+		box.top = 0;
+		box.bottom = 1;
+		box.front = 0;
+		box.back = 1;
+
+		m_deviceContext->UpdateSubresource(m_vertexBuffer, 0, &box, &m_vertices[ranges[i].first], 0, 0);
+	}
+}
+
+void App::onRender()
+{
+	m_deviceContext->ClearRenderTargetView(m_renderTargetView, Colors::Black);
+ 	m_deviceContext->ClearDepthStencilView(m_depthStencilView, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
+
+	m_deviceContext->VSSetShader(m_vertexShader, nullptr, 0);
+	m_deviceContext->VSSetConstantBuffers(0, 1, &cbObjectBuffer);
+	m_deviceContext->VSSetConstantBuffers(1, 1, &cbDrawBuffer);
+	m_deviceContext->PSSetShader(m_pixelShader, nullptr, 0);
+
+	m_deviceContext->DrawIndexed(m_numIndices, 0, 0);
+
+	DX::ThrowIfFailed(m_swapChain->Present(0, 0));
+}
+
+int WINAPI wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _In_ LPWSTR lpCmdLine, _In_ int nCmdShow)
+{
+	App app(hInstance);
+	app.onInit();
+	app.run();
+
+	return 0;
+}
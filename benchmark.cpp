@@ -0,0 +1,517 @@
+//
+// benchmark.cpp
+// Microbenchmarks for the ray kernels. Needs no Windows headers:
+//
+//   g++ -std=c++17 -O2 -pthread benchmark.cpp -o benchmark
+//   benchmark [--quick] [--out results.json] [--baseline baseline.json] [--threshold 0.1]
+//
+// Every accelerated path is checked against the brute-force kernel on the
+// same scene. Exits with 1 on a wrong result or when any case is slower than
+// the baseline by more than the threshold. A baseline is an earlier --out.
+//
+
+#include "pch.h"
+#include "rayTracer.cpp"
+#include "occluders.cpp"
+#include "compressedWalls.cpp"
+#include <cstdio>
+#include <map>
+
+enum class Distribution
+{
+	Uniform,
+	Clustered,
+	Grid
+};
+
+struct BenchmarkResult
+{
+	std::string name;
+	double items;
+	double seconds;
+	double throughput;
+	bool correct;
+};
+
+class Random
+{
+public:
+	Random(unsigned int seed) : m_state(seed) {};
+
+	float next()
+	{
+		m_state = m_state * 1664525u + 1013904223u;
+		return (m_state >> 8) / 16777216.0f;
+	}
+
+	float range(float min, float max)
+	{
+		return min + (max - min) * next();
+	}
+private:
+	unsigned int m_state;
+};
+
+class Benchmark
+{
+public:
+	Benchmark(bool quick) : m_minSeconds(quick ? 0.02 : 0.2), m_quick(quick) {};
+
+	void run()
+	{
+		const Distribution distributions[] = { Distribution::Uniform, Distribution::Clustered, Distribution::Grid };
+
+		std::vector<int> wallCounts = m_quick ? std::vector<int>{ 64, 512 } : std::vector<int>{ 64, 512, 4096 };
+		std::vector<int> rayCounts = m_quick ? std::vector<int>{ 256 } : std::vector<int>{ 256, 4096 };
+
+		for (int r = 0; r < rayCounts.size(); r++)
+		{
+			benchmarkPlacePoints(rayCounts[r]);
+		}
+
+		for (int d = 0; d < 3; d++)
+		{
+			for (int w = 0; w < wallCounts.size(); w++)
+			{
+				std::vector<Line> walls;
+				generateWalls(distributions[d], wallCounts[w], 1234u + w, walls);
+
+				for (int r = 0; r < rayCounts.size(); r++)
+				{
+					std::string suffix = std::string("/") + name(distributions[d]) + "/w" + std::to_string(wallCounts[w]) + "/r" + std::to_string(rayCounts[r]);
+
+					std::vector<Line> rays;
+					generateRays(rayCounts[r], 99u + r, rays);
+
+					benchmarkIntersect(walls, rays, suffix);
+					benchmarkClosestHit(walls, rays, suffix);
+					benchmarkLineOfSight(walls, rays, suffix);
+				}
+
+				benchmarkFan(walls, std::string("/") + name(distributions[d]) + "/w" + std::to_string(wallCounts[w]));
+
+				// Quadratic in walls per ray, so only the smaller scenes
+				if (wallCounts[w] <= 512)
+				{
+					benchmarkIntersectPoints(walls, std::string("/") + name(distributions[d]) + "/w" + std::to_string(wallCounts[w]));
+				}
+			}
+		}
+	}
+
+	const std::vector<BenchmarkResult> &results() const
+	{
+		return m_results;
+	}
+private:
+	void benchmarkPlacePoints(int numRays)
+	{
+		measure("place_points/r" + std::to_string(numRays), numRays, true, [&]()
+		{
+			Circle c(Vector3D(1.0f, 2.0f, 0.0f), 1.0f);
+			c.placePoints(numRays);
+			return c.circleLines.size();
+		});
+	}
+
+	void benchmarkIntersect(const std::vector<Line> &walls, const std::vector<Line> &rays, const std::string &suffix)
+	{
+		measure("line_intersect" + suffix, (double)walls.size() * rays.size(), true, [&]()
+		{
+			int hits = 0;
+			for (int i = 0; i < rays.size(); i++)
+			{
+				for (int j = 0; j < walls.size(); j++)
+				{
+					hits += !rays[i].intersect(walls[j]).isNan();
+				}
+			}
+			return hits;
+		});
+	}
+
+	void benchmarkClosestHit(const std::vector<Line> &walls, const std::vector<Line> &rays, const std::string &suffix)
+	{
+		Circle c;
+		std::vector<float> reference(rays.size());
+		measure("point_min_ray_magnitude" + suffix, rays.size(), true, [&]()
+		{
+			for (int i = 0; i < rays.size(); i++)
+			{
+				reference[i] = c.pointMinRayMagnitude(rays[i], walls);
+			}
+			return reference.size();
+		});
+
+		OccluderScene scene;
+		scene.lines = walls;
+		OccluderGrid grid;
+		grid.build(scene);
+
+		std::vector<float> distances(rays.size());
+		measure("grid_ray_magnitude" + suffix, rays.size(), false, [&]()
+		{
+			for (int i = 0; i < rays.size(); i++)
+			{
+				distances[i] = grid.rayMagnitude(rays[i]);
+			}
+			return distances.size();
+		});
+		m_results.back().correct = matches(reference, distances, 1e-3f, 0.0);
+
+		// Quantized endpoints move grazing hits, so allow a few misses
+		CompressedWalls compressed;
+		compressed.build(walls, 64.0f);
+		measure("compressed_closest_hit" + suffix, rays.size(), false, [&]()
+		{
+			for (int i = 0; i < rays.size(); i++)
+			{
+				Vector3D direction = rays[i].m_direction;
+				float length = direction.magnitude();
+				direction *= 1.0f / length;
+
+				distances[i] = compressed.closestHit(rays[i].m_p1, direction, length);
+			}
+			return distances.size();
+		});
+		m_results.back().correct = matches(reference, distances, 0.05f, 0.01);
+	}
+
+	void benchmarkLineOfSight(const std::vector<Line> &walls, const std::vector<Line> &rays, const std::string &suffix)
+	{
+		std::vector<Vector3D> from;
+		std::vector<Vector3D> to;
+		for (int i = 0; i < rays.size(); i++)
+		{
+			from.push_back(rays[i].m_p1);
+			to.push_back(rays[i].m_p1 + rays[i].m_direction * (1.0f / 16.0f));
+		}
+
+		std::vector<bool> reference(from.size());
+		measure("los_brute" + suffix, from.size(), true, [&]()
+		{
+			for (int i = 0; i < from.size(); i++)
+			{
+				Line segment(from[i], to[i]);
+
+				bool visible = true;
+				for (int j = 0; j < walls.size() && visible; j++)
+				{
+					visible = segment.intersect(walls[j]).isNan();
+				}
+				reference[i] = visible;
+			}
+			return reference.size();
+		});
+
+		WallBuffer buffer(walls);
+		std::vector<unsigned int> mask;
+		measure("los_batch" + suffix, from.size(), false, [&]()
+		{
+			LineOfSight::query(from, to, buffer, mask);
+			return mask.size();
+		});
+
+		int mismatches = 0;
+		for (int i = 0; i < from.size(); i++)
+		{
+			mismatches += LineOfSight::isPairVisible(mask, i) != reference[i];
+		}
+		m_results.back().correct = mismatches <= from.size() / 1000;
+	}
+
+	// One emitter's full fan: every wall per ray against angular buckets
+	// rebuilt for the emitter on each call
+	void benchmarkFan(const std::vector<Line> &walls, const std::string &suffix)
+	{
+		Circle c(Vector3D(0.5f, 0.25f, 0.0f), 1.0f);
+		c.placePoints(256);
+
+		std::vector<float> reference(c.circleLines.size());
+		measure("fan_brute" + suffix, reference.size(), true, [&]()
+		{
+			for (int i = 0; i < c.circleLines.size(); i++)
+			{
+				reference[i] = c.pointMinRayMagnitude(c.circleLines[i], walls);
+			}
+			return reference.size();
+		});
+
+		std::vector<float> distances(c.circleLines.size());
+		measure("fan_angular_buckets" + suffix, distances.size(), false, [&]()
+		{
+			AngularBuckets buckets;
+			buckets.build(c.pos, walls, (int)c.circleLines.size());
+			for (int i = 0; i < c.circleLines.size(); i++)
+			{
+				distances[i] = buckets.rayMagnitude(c.circleLines[i]);
+			}
+			return distances.size();
+		});
+		m_results.back().correct = matches(reference, distances, 0.0f, 0.0);
+	}
+
+	void benchmarkIntersectPoints(const std::vector<Line> &walls, const std::string &suffix)
+	{
+		measure("intersect_points" + suffix, 100, true, [&]()
+		{
+			Circle c(Vector3D(0.5f, 0.25f, 0.0f), 1.0f);
+			c.placePoints(100);
+
+			std::vector<Line> wallsToDraw;
+			c.intersectPoints(walls, wallsToDraw);
+			return wallsToDraw.size();
+		});
+	}
+
+	// Best time per call over enough calls to fill m_minSeconds
+	template<typename F>
+	void measure(const std::string &name, double items, bool correct, F f)
+	{
+		volatile size_t sink = f();
+
+		double best = INFINITY;
+		double total = 0.0;
+		int calls = 0;
+		while (total < m_minSeconds || calls < 3)
+		{
+			auto start = std::chrono::steady_clock::now();
+			sink = f();
+			double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+			best = std::min(best, seconds);
+			total += seconds;
+			calls++;
+		}
+		(void)sink;
+
+		best = std::max(best, 1e-9);
+		m_results.push_back(BenchmarkResult{ name, items, best, items / best, correct });
+	}
+
+	static bool matches(const std::vector<float> &reference, const std::vector<float> &distances, float tolerance, double allowedMisses)
+	{
+		int misses = 0;
+		for (int i = 0; i < reference.size(); i++)
+		{
+			float a = reference[i];
+			float b = distances[i];
+
+			bool same = (isinf(a) && isinf(b)) || fabs(a - b) <= tolerance * std::max(1.0f, fabs(a));
+			misses += !same;
+		}
+
+		return misses <= allowedMisses * reference.size();
+	}
+
+	static void generateWalls(Distribution distribution, int count, unsigned int seed, std::vector<Line> &walls)
+	{
+		Random random(seed);
+
+		if (distribution == Distribution::Uniform)
+		{
+			for (int i = 0; i < count; i++)
+			{
+				Vector3D a(random.range(-100.0f, 100.0f), random.range(-100.0f, 100.0f), 0.0f);
+				Vector3D b = a + Vector3D(random.range(-8.0f, 8.0f), random.range(-8.0f, 8.0f), 0.0f);
+				walls.push_back(Line(a, b));
+			}
+		}
+		else if (distribution == Distribution::Clustered)
+		{
+			Vector3D centers[8];
+			for (int c = 0; c < 8; c++)
+			{
+				centers[c] = Vector3D(random.range(-80.0f, 80.0f), random.range(-80.0f, 80.0f), 0.0f);
+			}
+
+			for (int i = 0; i < count; i++)
+			{
+				const Vector3D &center = centers[i % 8];
+				float spreadX = random.range(-6.0f, 6.0f) + random.range(-6.0f, 6.0f);
+				float spreadY = random.range(-6.0f, 6.0f) + random.range(-6.0f, 6.0f);
+
+				Vector3D a = center + Vector3D(spreadX, spreadY, 0.0f);
+				Vector3D b = a + Vector3D(random.range(-3.0f, 3.0f), random.range(-3.0f, 3.0f), 0.0f);
+				walls.push_back(Line(a, b));
+			}
+		}
+		else
+		{
+			// Alternating horizontal and vertical walls on a lattice
+			int side = std::max(1, (int)sqrt((float)count));
+			float spacing = 200.0f / side;
+			for (int i = 0; i < count; i++)
+			{
+				float x = -100.0f + (i % side) * spacing;
+				float y = -100.0f + ((i / side) % side) * spacing;
+
+				Vector3D a(x, y, 0.0f);
+				Vector3D b = i % 2 == 0 ? Vector3D(x + spacing * 0.8f, y, 0.0f) : Vector3D(x, y + spacing * 0.8f, 0.0f);
+				walls.push_back(Line(a, b));
+			}
+		}
+	}
+
+	static void generateRays(int count, unsigned int seed, std::vector<Line> &rays)
+	{
+		Random random(seed);
+
+		for (int i = 0; i < count; i++)
+		{
+			Vector3D origin(random.range(-100.0f, 100.0f) + 0.37f, random.range(-100.0f, 100.0f) + 0.61f, 0.0f);
+			float theta = random.range(0.0f, 2 * M_PI);
+
+			rays.push_back(Line(origin, origin + Vector3D(cos(theta), sin(theta), 0.0f) * 1024.0f));
+		}
+	}
+
+	static const char *name(Distribution distribution)
+	{
+		switch (distribution)
+		{
+		case Distribution::Uniform:
+			return "uniform";
+		case Distribution::Clustered:
+			return "clustered";
+		default:
+			return "grid";
+		}
+	}
+private:
+	double m_minSeconds;
+	bool m_quick;
+	std::vector<BenchmarkResult> m_results;
+};
+
+std::string toJson(const std::vector<BenchmarkResult> &results)
+{
+	std::ostringstream out;
+	out.precision(9);
+	out << "{\n  \"results\": [\n";
+	for (int i = 0; i < results.size(); i++)
+	{
+		const BenchmarkResult &r = results[i];
+		out << "    { \"name\": \"" << r.name << "\", \"items\": " << r.items << ", \"seconds\": " << r.seconds
+			<< ", \"throughput\": " << r.throughput << ", \"correct\": " << (r.correct ? "true" : "false") << " }"
+			<< (i + 1 < results.size() ? ",\n" : "\n");
+	}
+	out << "  ]\n}\n";
+
+	return out.str();
+}
+
+// Reads name -> throughput back out of a file written by toJson
+std::map<std::string, double> readBaseline(const std::string &path)
+{
+	std::map<std::string, double> baseline;
+
+	std::ifstream file(path);
+	if (!file)
+	{
+		throw std::runtime_error("Cannot open baseline " + path);
+	}
+
+	std::stringstream buffer;
+	buffer << file.rdbuf();
+	std::string text = buffer.str();
+
+	const std::string nameKey = "\"name\": \"";
+	const std::string throughputKey = "\"throughput\": ";
+	size_t pos = 0;
+	while ((pos = text.find(nameKey, pos)) != std::string::npos)
+	{
+		size_t nameStart = pos + nameKey.size();
+		size_t nameEnd = text.find('"', nameStart);
+		size_t value = text.find(throughputKey, nameEnd);
+		if (nameEnd == std::string::npos || value == std::string::npos)
+		{
+			break;
+		}
+
+		baseline[text.substr(nameStart, nameEnd - nameStart)] = strtod(text.c_str() + value + throughputKey.size(), nullptr);
+		pos = value;
+	}
+
+	return baseline;
+}
+
+int main(int argc, char **argv)
+{
+	bool quick = false;
+	std::string outPath;
+	std::string baselinePath;
+	double threshold = 0.1;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if (arg == "--quick")
+		{
+			quick = true;
+		}
+		else if (arg == "--out" && i + 1 < argc)
+		{
+			outPath = argv[++i];
+		}
+		else if (arg == "--baseline" && i + 1 < argc)
+		{
+			baselinePath = argv[++i];
+		}
+		else if (arg == "--threshold" && i + 1 < argc)
+		{
+			threshold = atof(argv[++i]);
+		}
+		else
+		{
+			fprintf(stderr, "usage: %s [--quick] [--out results.json] [--baseline baseline.json] [--threshold 0.1]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	Benchmark benchmark(quick);
+	benchmark.run();
+
+	const std::vector<BenchmarkResult> &results = benchmark.results();
+	std::string json = toJson(results);
+	if (outPath.empty())
+	{
+		fputs(json.c_str(), stdout);
+	}
+	else
+	{
+		std::ofstream(outPath) << json;
+	}
+
+	bool failed = false;
+	for (int i = 0; i < results.size(); i++)
+	{
+		if (!results[i].correct)
+		{
+			fprintf(stderr, "WRONG   %s disagrees with the brute-force reference\n", results[i].name.c_str());
+			failed = true;
+		}
+	}
+
+	if (!baselinePath.empty())
+	{
+		std::map<std::string, double> baseline = readBaseline(baselinePath);
+		for (int i = 0; i < results.size(); i++)
+		{
+			auto it = baseline.find(results[i].name);
+			if (it == baseline.end())
+			{
+				continue;
+			}
+
+			double ratio = results[i].throughput / it->second;
+			if (ratio < 1.0 - threshold)
+			{
+				fprintf(stderr, "SLOWER  %s %.1f%% of baseline\n", results[i].name.c_str(), ratio * 100.0);
+				failed = true;
+			}
+		}
+	}
+
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,252 @@
+#pragma once
+#include "pch.h"
+#include "occluders.cpp"
+
+struct SweepHit
+{
+	bool hit;
+	float toi;
+	Vector3D normal;
+};
+
+struct MovingBody
+{
+	Vector3D pos;
+	float r;
+	Vector3D delta;
+};
+
+// Circle of radius r moving from p by d (t in [0, 1]). Each helper lowers toi
+// and sets the contact normal when it finds an earlier contact.
+class SweepKernels
+{
+public:
+	static void point(const Vector3D &p, const Vector3D &d, float r, const Vector3D &e, float &toi, Vector3D &normal)
+	{
+		float ox = p.x - e.x;
+		float oy = p.y - e.y;
+		float a = d.x * d.x + d.y * d.y;
+		float b = ox * d.x + oy * d.y;
+		float c = ox * ox + oy * oy - r * r;
+
+		if (a == 0.0f || b >= 0.0f)
+		{
+			return;
+		}
+
+		float discriminant = b * b - a * c;
+		if (discriminant < 0.0f)
+		{
+			return;
+		}
+
+		float t = std::max(0.0f, (-b - sqrt(discriminant)) / a);
+		if (t < toi)
+		{
+			toi = t;
+			normal = Vector3D(ox + d.x * t, oy + d.y * t, 0.0f);
+			normal.normalize();
+		}
+	}
+
+	static void segment(const Vector3D &p, const Vector3D &d, float r, const Vector3D &a, const Vector3D &b, float &toi, Vector3D &normal)
+	{
+		Vector3D ab = b - a;
+		float length = ab.magnitude();
+		if (length == 0.0f)
+		{
+			point(p, d, r, a, toi, normal);
+			return;
+		}
+
+		Vector3D n(-ab.y / length, ab.x / length, 0.0f);
+		float distance = n.dotProduct(p - a);
+		if (distance < 0.0f)
+		{
+			n *= -1.0f;
+			distance = -distance;
+		}
+
+		float speed = n.dotProduct(d);
+		if (speed < 0.0f)
+		{
+			// Already touching the face counts as a contact at t = 0
+			float t = std::max(0.0f, (distance - r) / -speed);
+			Vector3D contact = p + d * t - n * r;
+			float u = (contact - a).dotProduct(ab) / (length * length);
+
+			if (u >= 0.0f && u <= 1.0f && t < toi)
+			{
+				toi = t;
+				normal = n;
+			}
+		}
+
+		point(p, d, r, a, toi, normal);
+		point(p, d, r, b, toi, normal);
+	}
+};
+
+template<typename T>
+struct SweepTraits;
+
+template<>
+struct SweepTraits<Line>
+{
+	static void sweep(const Line &l, const Vector3D &p, const Vector3D &d, float r, float &toi, Vector3D &normal)
+	{
+		SweepKernels::segment(p, d, r, l.m_p1, l.m_p2, toi, normal);
+	}
+};
+
+template<>
+struct SweepTraits<Disc>
+{
+	static void sweep(const Disc &disc, const Vector3D &p, const Vector3D &d, float r, float &toi, Vector3D &normal)
+	{
+		SweepKernels::point(p, d, r + disc.r, disc.center, toi, normal);
+	}
+};
+
+template<>
+struct SweepTraits<Box>
+{
+	static void sweep(const Box &box, const Vector3D &p, const Vector3D &d, float r, float &toi, Vector3D &normal)
+	{
+		Vector3D corners[4] =
+		{
+			box.min,
+			Vector3D(box.max.x, box.min.y, 0.0f),
+			box.max,
+			Vector3D(box.min.x, box.max.y, 0.0f)
+		};
+
+		for (int i = 0; i < 4; i++)
+		{
+			SweepKernels::segment(p, d, r, corners[i], corners[(i + 1) % 4], toi, normal);
+		}
+	}
+};
+
+template<>
+struct SweepTraits<ConvexPolygon>
+{
+	static void sweep(const ConvexPolygon &polygon, const Vector3D &p, const Vector3D &d, float r, float &toi, Vector3D &normal)
+	{
+		const std::vector<Vector3D> &points = polygon.points;
+		for (int i = 0; i < points.size(); i++)
+		{
+			SweepKernels::segment(p, d, r, points[i], points[(i + 1) % points.size()], toi, normal);
+		}
+	}
+};
+
+// Continuous circle collision on the same OccluderGrid the visibility
+// queries use, so physics and visibility share one spatial index
+class SweptCircle
+{
+public:
+	static SweepHit sweep(const OccluderGrid &grid, const Vector3D &pos, float r, const Vector3D &delta)
+	{
+		SweepHit hit{ false, 1.0f, Vector3D(0.0f, 0.0f, 0.0f) };
+
+		Vector3D end = pos + delta;
+		Vector3D min(std::min(pos.x, end.x) - r, std::min(pos.y, end.y) - r, 0.0f);
+		Vector3D max(std::max(pos.x, end.x) + r, std::max(pos.y, end.y) + r, 0.0f);
+
+		float toi = INFINITY;
+		grid.forEachCell(min, max, [&](int cell)
+		{
+			sweepCell<Line>(grid, cell, pos, delta, r, toi, hit.normal);
+			sweepCell<Disc>(grid, cell, pos, delta, r, toi, hit.normal);
+			sweepCell<Box>(grid, cell, pos, delta, r, toi, hit.normal);
+			sweepCell<ConvexPolygon>(grid, cell, pos, delta, r, toi, hit.normal);
+		});
+
+		if (toi <= 1.0f)
+		{
+			hit.hit = true;
+			hit.toi = toi;
+		}
+
+		return hit;
+	}
+
+	// Moves as far as possible, then slides the rest of the motion along the
+	// contact normal
+	static Vector3D move(const OccluderGrid &grid, const Vector3D &pos, float r, const Vector3D &delta, int maxIterations = 3)
+	{
+		const float skin = 1e-3f;
+
+		Vector3D p = pos;
+		Vector3D d = delta;
+		for (int i = 0; i < maxIterations; i++)
+		{
+			SweepHit hit = sweep(grid, p, r, d);
+			if (!hit.hit)
+			{
+				return p + d;
+			}
+
+			float length = d.magnitude();
+			float t = length > 0.0f ? std::max(0.0f, hit.toi - skin / length) : 0.0f;
+			p += d * t;
+
+			Vector3D rest = d * (1.0f - t);
+			d = rest - hit.normal * rest.dotProduct(hit.normal);
+		}
+
+		return p;
+	}
+
+	static void moveAll(const OccluderGrid &grid, std::vector<MovingBody> &bodies, int numThreads = 0)
+	{
+		if (numThreads <= 0)
+		{
+			numThreads = std::max(1, (int)std::thread::hardware_concurrency());
+		}
+		numThreads = std::max(1, std::min(numThreads, (int)bodies.size()));
+
+		int perThread = ((int)bodies.size() + numThreads - 1) / std::max(1, numThreads);
+		auto worker = [&](int first, int last)
+		{
+			for (int i = first; i < last; i++)
+			{
+				MovingBody &b = bodies[i];
+				b.pos = move(grid, b.pos, b.r, b.delta);
+			}
+		};
+
+		std::vector<std::thread> threads;
+		for (int t = 1; t < numThreads; t++)
+		{
+			int first = t * perThread;
+			int last = std::min((int)bodies.size(), first + perThread);
+			if (first < last)
+			{
+				threads.push_back(std::thread(worker, first, last));
+			}
+		}
+
+		worker(0, std::min((int)bodies.size(), perThread));
+
+		for (int t = 0; t < threads.size(); t++)
+		{
+			threads[t].join();
+		}
+	}
+private:
+	template<typename T>
+	static void sweepCell(const OccluderGrid &grid, int cell, const Vector3D &pos, const Vector3D &delta, float r, float &toi, Vector3D &normal)
+	{
+		const std::vector<T> &items = grid.scene().items<T>();
+
+		const int *first;
+		const int *last;
+		grid.cellItems<T>(cell, first, last);
+		for (const int *i = first; i != last; i++)
+		{
+			SweepTraits<T>::sweep(items[*i], pos, delta, r, toi, normal);
+		}
+	}
+};
@@ -0,0 +1,326 @@
+#pragma once
+#include "pch.h"
+#include "rayTracer.cpp"
+
+struct WallTile
+{
+	int tileX;
+	int tileY;
+	int firstVertex;
+	int numVertices;
+	int firstWall;
+	int numWalls;
+};
+
+// Compact wall storage for very large maps. Space is cut into square tiles;
+// every tile keeps its vertices as 16-bit offsets from the tile centre, and
+// its walls as pairs of 16-bit indices into those vertices, so walls that
+// meet share one vertex. Vertices snap to one lattice over the whole map, so
+// walls that meet across a tile boundary still meet once decoded. A wall
+// costs 4 bytes plus its share of the vertices, against 36 bytes for a Line.
+class CompressedWalls
+{
+public:
+	CompressedWalls() : m_tileSize(256.0f), m_scale(1.0f), m_minTileX(0), m_maxTileX(0), m_minTileY(0), m_maxTileY(0) {};
+
+	void build(const std::vector<Line> &lines, float tileSize = 256.0f)
+	{
+		m_tileSize = tileSize;
+		// Offsets reach a full tile from the centre, which is half a tile
+		// past its edges, so a wall only has to be split when it reaches
+		// further. A tile spans an even number of lattice steps, which puts
+		// every tile centre on the lattice
+		m_scale = tileSize / (float)(2 * tileHalfSteps);
+
+		m_tiles.clear();
+		m_tileIndex.clear();
+		m_vx.clear();
+		m_vy.clear();
+		m_wallA.clear();
+		m_wallB.clear();
+
+		std::vector<std::pair<unsigned long long, Line>> segments;
+		for (int i = 0; i < lines.size(); i++)
+		{
+			addSegment(lines[i].m_p1, lines[i].m_p2, segments);
+		}
+
+		std::sort(segments.begin(), segments.end(), [](const std::pair<unsigned long long, Line> &a, const std::pair<unsigned long long, Line> &b)
+		{
+			return a.first < b.first;
+		});
+
+		std::unordered_map<unsigned int, unsigned short> vertices;
+		for (int i = 0; i < segments.size(); i++)
+		{
+			if (i == 0 || segments[i].first != segments[i - 1].first)
+			{
+				int tileX = (int)(unsigned int)(segments[i].first >> 32) - 0x40000000;
+				int tileY = (int)(unsigned int)(segments[i].first & 0xffffffffu) - 0x40000000;
+
+				WallTile tile;
+				tile.tileX = tileX;
+				tile.tileY = tileY;
+				tile.firstVertex = (int)m_vx.size();
+				tile.numVertices = 0;
+				tile.firstWall = (int)m_wallA.size();
+				tile.numWalls = 0;
+				m_tileIndex[segments[i].first] = (int)m_tiles.size();
+				m_tiles.push_back(tile);
+
+				m_minTileX = m_tiles.size() == 1 ? tileX : std::min(m_minTileX, tileX);
+				m_maxTileX = m_tiles.size() == 1 ? tileX : std::max(m_maxTileX, tileX);
+				m_minTileY = m_tiles.size() == 1 ? tileY : std::min(m_minTileY, tileY);
+				m_maxTileY = m_tiles.size() == 1 ? tileY : std::max(m_maxTileY, tileY);
+
+				vertices.clear();
+			}
+
+			WallTile &tile = m_tiles.back();
+			m_wallA.push_back(addVertex(tile, segments[i].second.m_p1, vertices));
+			m_wallB.push_back(addVertex(tile, segments[i].second.m_p2, vertices));
+			tile.numWalls++;
+		}
+	}
+
+	// Distance to the first wall along a unit direction, INFINITY if none.
+	// Walks the tile cells the ray crosses; walls reach at most half a tile
+	// past their own tile, so each cell also checks its eight neighbours.
+	// The walk ends once the ray has left the tiles' bounding box.
+	float closestHit(const Vector3D &origin, const Vector3D &direction, float maxDistance) const
+	{
+		float bestDistance = maxDistance;
+		bool hit = false;
+
+		if (m_tiles.empty())
+		{
+			return INFINITY;
+		}
+
+		int x = (int)floor(origin.x / m_tileSize);
+		int y = (int)floor(origin.y / m_tileSize);
+		int stepX = direction.x > 0.0f ? 1 : -1;
+		int stepY = direction.y > 0.0f ? 1 : -1;
+		float tDeltaX = direction.x != 0.0f ? m_tileSize / fabs(direction.x) : INFINITY;
+		float tDeltaY = direction.y != 0.0f ? m_tileSize / fabs(direction.y) : INFINITY;
+		float tMaxX = direction.x != 0.0f ? ((x + (stepX > 0)) * m_tileSize - origin.x) / direction.x : INFINITY;
+		float tMaxY = direction.y != 0.0f ? ((y + (stepY > 0)) * m_tileSize - origin.y) / direction.y : INFINITY;
+
+		int tested[16];
+		int numTested = 0;
+		while (true)
+		{
+			// No neighbourhood further along can hold a tile
+			if ((stepX > 0 ? x - 1 > m_maxTileX : x + 1 < m_minTileX) || (stepY > 0 ? y - 1 > m_maxTileY : y + 1 < m_minTileY))
+			{
+				break;
+			}
+
+			for (int ny = y - 1; ny <= y + 1; ny++)
+			{
+				for (int nx = x - 1; nx <= x + 1; nx++)
+				{
+					auto it = m_tileIndex.find(tileKey(nx, ny));
+					if (it == m_tileIndex.end() || std::find(tested, tested + numTested, it->second) != tested + numTested)
+					{
+						continue;
+					}
+
+					// Neighbourhoods of consecutive cells overlap by six tiles at most
+					if (numTested == 16)
+					{
+						std::copy(tested + 8, tested + 16, tested);
+						numTested = 8;
+					}
+					tested[numTested++] = it->second;
+
+					if (testTile(m_tiles[it->second], origin, direction, bestDistance))
+					{
+						hit = true;
+					}
+				}
+			}
+
+			float cellExit = std::min(tMaxX, tMaxY);
+			if ((hit && bestDistance <= cellExit) || cellExit >= maxDistance)
+			{
+				break;
+			}
+
+			if (tMaxX < tMaxY)
+			{
+				x += stepX;
+				tMaxX += tDeltaX;
+			}
+			else
+			{
+				y += stepY;
+				tMaxY += tDeltaY;
+			}
+		}
+
+		return hit ? bestDistance : INFINITY;
+	}
+
+	// Any-hit test for the open segment between two points
+	bool isVisible(const Vector3D &from, const Vector3D &to) const
+	{
+		Vector3D direction = to - from;
+		float length = direction.magnitude();
+		if (length == 0.0f)
+		{
+			return true;
+		}
+		direction *= 1.0f / length;
+
+		float hit = closestHit(from, direction, length);
+
+		return !(hit > 0.0f && hit < length);
+	}
+
+	void decode(std::vector<Line> &lines) const
+	{
+		for (int i = 0; i < m_tiles.size(); i++)
+		{
+			const WallTile &tile = m_tiles[i];
+			for (int w = 0; w < tile.numWalls; w++)
+			{
+				lines.push_back(Line(vertex(tile, m_wallA[tile.firstWall + w]), vertex(tile, m_wallB[tile.firstWall + w])));
+			}
+		}
+	}
+
+	size_t memoryUsage() const
+	{
+		return m_tiles.size() * (sizeof(WallTile) + sizeof(unsigned long long) + sizeof(int)) + (m_vx.size() + m_vy.size()) * sizeof(short) + (m_wallA.size() + m_wallB.size()) * sizeof(unsigned short);
+	}
+
+	int numWalls() const
+	{
+		return (int)m_wallA.size();
+	}
+private:
+	void addSegment(const Vector3D &a, const Vector3D &b, std::vector<std::pair<unsigned long long, Line>> &segments) const
+	{
+		Vector3D mid = (a + b) * 0.5f;
+		int tileX = (int)floor(mid.x / m_tileSize);
+		int tileY = (int)floor(mid.y / m_tileSize);
+		float centerX = (tileX + 0.5f) * m_tileSize;
+		float centerY = (tileY + 0.5f) * m_tileSize;
+
+		float reach = std::max(std::max(fabs(a.x - centerX), fabs(a.y - centerY)), std::max(fabs(b.x - centerX), fabs(b.y - centerY)));
+		if (reach > m_tileSize)
+		{
+			addSegment(a, mid, segments);
+			addSegment(mid, b, segments);
+			return;
+		}
+
+		segments.push_back(std::make_pair(tileKey(tileX, tileY), Line(a, b)));
+	}
+
+	// Snapped to the map-wide lattice first, then stored relative to the tile
+	unsigned short addVertex(WallTile &tile, const Vector3D &p, std::unordered_map<unsigned int, unsigned short> &vertices)
+	{
+		long long gx = llround(p.x / (double)m_scale);
+		long long gy = llround(p.y / (double)m_scale);
+		short qx = (short)std::max(-32767ll, std::min(32767ll, gx - tileCenter(tile.tileX)));
+		short qy = (short)std::max(-32767ll, std::min(32767ll, gy - tileCenter(tile.tileY)));
+		unsigned int key = ((unsigned int)(unsigned short)qx << 16) | (unsigned short)qy;
+
+		auto it = vertices.find(key);
+		if (it != vertices.end())
+		{
+			return it->second;
+		}
+
+		if (tile.numVertices > 0xffff)
+		{
+			throw std::runtime_error("CompressedWalls: too many vertices in one tile, use a smaller tile size");
+		}
+
+		unsigned short index = (unsigned short)tile.numVertices++;
+		m_vx.push_back(qx);
+		m_vy.push_back(qy);
+		vertices[key] = index;
+
+		return index;
+	}
+
+	// Rounded once from the lattice position, so every tile decodes a shared
+	// vertex the same
+	Vector3D vertex(const WallTile &tile, unsigned short index) const
+	{
+		float x = (float)((tileCenter(tile.tileX) + m_vx[tile.firstVertex + index]) * (double)m_scale);
+		float y = (float)((tileCenter(tile.tileY) + m_vy[tile.firstVertex + index]) * (double)m_scale);
+
+		return Vector3D(x, y, 0.0f);
+	}
+
+	// Tile-local quantized space; distances along the ray are unchanged
+	bool testTile(const WallTile &tile, const Vector3D &origin, const Vector3D &direction, float &bestDistance) const
+	{
+		float px = (float)(origin.x / (double)m_scale - tileCenter(tile.tileX));
+		float py = (float)(origin.y / (double)m_scale - tileCenter(tile.tileY));
+		float rx = direction.x / m_scale;
+		float ry = direction.y / m_scale;
+
+		const short *vx = &m_vx[tile.firstVertex];
+		const short *vy = &m_vy[tile.firstVertex];
+		const unsigned short *wallA = &m_wallA[tile.firstWall];
+		const unsigned short *wallB = &m_wallB[tile.firstWall];
+
+		bool hit = false;
+		for (int w = 0; w < tile.numWalls; w++)
+		{
+			float qx = vx[wallA[w]];
+			float qy = vy[wallA[w]];
+			float sx = vx[wallB[w]] - qx;
+			float sy = vy[wallB[w]] - qy;
+
+			float denom = rx * sy - ry * sx;
+			float ox = qx - px;
+			float oy = qy - py;
+			float t = (ox * sy - oy * sx) / denom;
+			float u = (ox * ry - oy * rx) / denom;
+
+			// Walls overlap slightly at their ends, so a ray at a joint between
+			// two tiles is not lost to the rounding of either tile's origin
+			if (t >= 0.0f && t < bestDistance && u >= -1e-4f && u <= 1.0f + 1e-4f)
+			{
+				bestDistance = t;
+				hit = true;
+			}
+		}
+
+		return hit;
+	}
+
+	// Lattice position of a tile's centre on one axis
+	static long long tileCenter(int tile)
+	{
+		return tile * (2ll * tileHalfSteps) + tileHalfSteps;
+	}
+
+	static unsigned long long tileKey(int tileX, int tileY)
+	{
+		return ((unsigned long long)(unsigned int)(tileX + 0x40000000) << 32) | (unsigned int)(tileY + 0x40000000);
+	}
+
+private:
+	// Lattice steps from a tile's centre to its edge
+	static const int tileHalfSteps = 16383;
+
+	float m_tileSize;
+	float m_scale;
+	std::vector<WallTile> m_tiles;
+	int m_minTileX;
+	int m_maxTileX;
+	int m_minTileY;
+	int m_maxTileY;
+	std::unordered_map<unsigned long long, int> m_tileIndex;
+	std::vector<short> m_vx;
+	std::vector<short> m_vy;
+	std::vector<unsigned short> m_wallA;
+	std::vector<unsigned short> m_wallB;
+};
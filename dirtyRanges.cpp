@@ -0,0 +1,115 @@
+#pragma once
+#include "pch.h"
+
+struct DirtyRange
+{
+	int first;
+	int count;
+};
+
+// Remembers the last uploaded copy of a stream and reports which parts of
+// the new one differ, as a short list of coalesced element ranges. Items are
+// groups of elements that change together (the two vertices of a ray).
+template<typename T>
+class DirtyRangeTracker
+{
+public:
+	DirtyRangeTracker() : mergeGap(8) {};
+
+	const std::vector<DirtyRange> &update(const std::vector<T> &current, int itemSize = 1)
+	{
+		m_ranges.clear();
+
+		int size = (int)current.size();
+		if (m_previous.size() != current.size())
+		{
+			if (size > 0)
+			{
+				m_ranges.push_back(DirtyRange{ 0, size });
+			}
+			m_previous = current;
+
+			return m_ranges;
+		}
+
+		for (int i = 0; i < size; i += itemSize)
+		{
+			int count = std::min(itemSize, size - i);
+			if (memcmp(&current[i], &m_previous[i], count * sizeof(T)) == 0)
+			{
+				continue;
+			}
+
+			memcpy(&m_previous[i], &current[i], count * sizeof(T));
+			addRange(i, count);
+		}
+
+		return m_ranges;
+	}
+
+	// For producers that already know which items changed, so nothing has to
+	// be compared: stores those items of current and coalesces them
+	const std::vector<DirtyRange> &update(const std::vector<T> &current, std::vector<int> dirtyItems, int itemSize = 1)
+	{
+		m_ranges.clear();
+
+		int size = (int)current.size();
+		if (m_previous.size() != current.size())
+		{
+			return update(current, itemSize);
+		}
+
+		std::sort(dirtyItems.begin(), dirtyItems.end());
+		dirtyItems.erase(std::unique(dirtyItems.begin(), dirtyItems.end()), dirtyItems.end());
+
+		for (int k = 0; k < dirtyItems.size(); k++)
+		{
+			int i = dirtyItems[k] * itemSize;
+			if (i < 0 || i >= size)
+			{
+				continue;
+			}
+
+			int count = std::min(itemSize, size - i);
+			std::copy(current.begin() + i, current.begin() + i + count, m_previous.begin() + i);
+			addRange(i, count);
+		}
+
+		return m_ranges;
+	}
+
+	// CPU backend: copy only the dirty ranges of the last update into dst
+	void copyRanges(std::vector<T> &dst) const
+	{
+		dst.resize(m_previous.size());
+
+		for (int i = 0; i < m_ranges.size(); i++)
+		{
+			std::copy(m_previous.begin() + m_ranges[i].first, m_previous.begin() + m_ranges[i].first + m_ranges[i].count, dst.begin() + m_ranges[i].first);
+		}
+	}
+
+	const std::vector<DirtyRange> &ranges() const
+	{
+		return m_ranges;
+	}
+public:
+	int mergeGap;
+private:
+	// Ranges come in ascending order; small clean gaps are cheaper to
+	// re-upload than to split around
+	void addRange(int first, int count)
+	{
+		if (!m_ranges.empty() && first - (m_ranges.back().first + m_ranges.back().count) <= mergeGap)
+		{
+			m_ranges.back().count = first + count - m_ranges.back().first;
+		}
+		else
+		{
+			m_ranges.push_back(DirtyRange{ first, count });
+		}
+	}
+private:
+	std::vector<T> m_previous;
+	std::vector<DirtyRange> m_ranges;
+};
@@ -0,0 +1,344 @@
+#pragma once
+#include "pch.h"
+#include "rayTracer.cpp"
+
+// Cells covered by one emitter's visibility polygon, kept for the bounding
+// rows and 64-cell words it touches only
+struct FogMask
+{
+	int row0;
+	int row1;
+	int word0;
+	int word1;
+	std::vector<unsigned long long> bits;
+};
+
+struct FogEmitter
+{
+	int id;
+	int team;
+	std::vector<Vector3D> polygon;
+	FogMask mask;
+	bool dirty;
+};
+
+// Per-team "visible now" and "explored" bitsets over a tile grid, one bit per
+// cell and 64 cells per word. Only emitters whose polygon changed since the
+// last update are rasterized again; the others are merged back in from their
+// cached masks. An update with nothing changed does no work.
+class FogOfWar
+{
+public:
+	FogOfWar(int width, int height, float cellSize, const Vector3D &origin, int numTeams) :
+		m_width(width),
+		m_height(height),
+		m_wordsPerRow((width + 63) / 64),
+		m_cellSize(cellSize),
+		m_origin(origin),
+		m_numTeams(numTeams),
+		m_removed(false),
+		m_visible(new std::atomic<unsigned long long>[(size_t)numTeams * height * ((width + 63) / 64)]),
+		m_explored((size_t)numTeams * height * ((width + 63) / 64), 0)
+	{
+		size_t size = (size_t)numTeams * m_height * m_wordsPerRow;
+		for (size_t i = 0; i < size; i++)
+		{
+			m_visible[i].store(0, std::memory_order_relaxed);
+		}
+	}
+
+	// Marks the emitter dirty only when its polygon actually changed
+	void setEmitter(int id, int team, const std::vector<Vector3D> &polygon)
+	{
+		for (int i = 0; i < m_emitters.size(); i++)
+		{
+			FogEmitter &e = m_emitters[i];
+			if (e.id != id)
+			{
+				continue;
+			}
+
+			if (e.team != team || !samePolygon(e.polygon, polygon))
+			{
+				e.team = team;
+				e.polygon = polygon;
+				e.dirty = true;
+			}
+			return;
+		}
+
+		m_emitters.push_back(FogEmitter{ id, team, polygon, FogMask{ 0, -1, 0, -1, {} }, true });
+	}
+
+	// The fan end points of c, after Circle::intersectPoints, as a polygon
+	void setEmitter(int id, int team, const Circle &c)
+	{
+		std::vector<Vector3D> polygon;
+		for (int i = 0; i < c.circleLines.size(); i++)
+		{
+			polygon.push_back(c.circleLines[i].m_p2);
+		}
+
+		setEmitter(id, team, polygon);
+	}
+
+	void removeEmitter(int id)
+	{
+		for (int i = 0; i < m_emitters.size(); i++)
+		{
+			if (m_emitters[i].id == id)
+			{
+				m_emitters.erase(m_emitters.begin() + i);
+				m_removed = true;
+				return;
+			}
+		}
+	}
+
+	void update(int numThreads = 0)
+	{
+		if (numThreads <= 0)
+		{
+			numThreads = std::max(1, (int)std::thread::hardware_concurrency());
+		}
+
+		std::vector<int> dirty;
+		for (int i = 0; i < m_emitters.size(); i++)
+		{
+			if (m_emitters[i].dirty)
+			{
+				dirty.push_back(i);
+			}
+		}
+
+		// Visible and explored cells only change with an emitter
+		if (dirty.empty() && !m_removed)
+		{
+			return;
+		}
+		m_removed = false;
+
+		parallelFor((int)dirty.size(), numThreads, [&](int i)
+		{
+			FogEmitter &e = m_emitters[dirty[i]];
+			rasterize(e.polygon, e.mask);
+			e.dirty = false;
+		});
+
+		size_t size = (size_t)m_numTeams * m_height * m_wordsPerRow;
+		for (size_t i = 0; i < size; i++)
+		{
+			m_visible[i].store(0, std::memory_order_relaxed);
+		}
+
+		// Emitters of one team overlap, so merge with lock-free ORs
+		parallelFor((int)m_emitters.size(), numThreads, [&](int i)
+		{
+			const FogEmitter &e = m_emitters[i];
+			if (e.team < 0 || e.team >= m_numTeams)
+			{
+				return;
+			}
+
+			const FogMask &mask = e.mask;
+			int maskWords = mask.word1 - mask.word0 + 1;
+			for (int row = mask.row0; row <= mask.row1; row++)
+			{
+				const unsigned long long *src = &mask.bits[(size_t)(row - mask.row0) * maskWords];
+				std::atomic<unsigned long long> *dst = &m_visible[word(e.team, row, mask.word0)];
+				for (int w = 0; w < maskWords; w++)
+				{
+					if (src[w])
+					{
+						dst[w].fetch_or(src[w], std::memory_order_relaxed);
+					}
+				}
+			}
+		});
+
+		for (size_t i = 0; i < size; i++)
+		{
+			m_explored[i] |= m_visible[i].load(std::memory_order_relaxed);
+		}
+	}
+
+	bool isVisible(int team, int x, int y) const
+	{
+		return (m_visible[word(team, y, x / 64)].load(std::memory_order_relaxed) >> (x % 64)) & 1;
+	}
+
+	bool isExplored(int team, int x, int y) const
+	{
+		return (m_explored[word(team, y, x / 64)] >> (x % 64)) & 1;
+	}
+
+	// Row-major bitsets, wordsPerRow() words per row
+	void copyVisible(int team, std::vector<unsigned long long> &bits) const
+	{
+		size_t size = (size_t)m_height * m_wordsPerRow;
+		bits.resize(size);
+		for (size_t i = 0; i < size; i++)
+		{
+			bits[i] = m_visible[team * size + i].load(std::memory_order_relaxed);
+		}
+	}
+
+	void copyExplored(int team, std::vector<unsigned long long> &bits) const
+	{
+		size_t size = (size_t)m_height * m_wordsPerRow;
+		bits.assign(m_explored.begin() + team * size, m_explored.begin() + (team + 1) * size);
+	}
+
+	int wordsPerRow() const
+	{
+		return m_wordsPerRow;
+	}
+private:
+	size_t word(int team, int row, int w) const
+	{
+		return ((size_t)team * m_height + row) * m_wordsPerRow + w;
+	}
+
+	static bool samePolygon(const std::vector<Vector3D> &a, const std::vector<Vector3D> &b)
+	{
+		if (a.size() != b.size())
+		{
+			return false;
+		}
+
+		for (int i = 0; i < a.size(); i++)
+		{
+			if (a[i].x != b[i].x || a[i].y != b[i].y)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	// Even-odd scanline fill sampled at cell centres
+	void rasterize(const std::vector<Vector3D> &polygon, FogMask &mask) const
+	{
+		mask.bits.clear();
+		mask.row0 = 0;
+		mask.row1 = -1;
+		mask.word0 = 0;
+		mask.word1 = -1;
+
+		if (polygon.size() < 3)
+		{
+			return;
+		}
+
+		float minX = INFINITY, minY = INFINITY, maxX = -INFINITY, maxY = -INFINITY;
+		for (int i = 0; i < polygon.size(); i++)
+		{
+			minX = std::min(minX, polygon[i].x);
+			minY = std::min(minY, polygon[i].y);
+			maxX = std::max(maxX, polygon[i].x);
+			maxY = std::max(maxY, polygon[i].y);
+		}
+
+		mask.row0 = std::max(0, (int)floor((minY - m_origin.y) / m_cellSize));
+		mask.row1 = std::min(m_height - 1, (int)floor((maxY - m_origin.y) / m_cellSize));
+		int col0 = std::max(0, (int)floor((minX - m_origin.x) / m_cellSize));
+		int col1 = std::min(m_width - 1, (int)floor((maxX - m_origin.x) / m_cellSize));
+		if (mask.row0 > mask.row1 || col0 > col1)
+		{
+			mask.row1 = mask.row0 - 1;
+			return;
+		}
+
+		mask.word0 = col0 / 64;
+		mask.word1 = col1 / 64;
+		int maskWords = mask.word1 - mask.word0 + 1;
+		mask.bits.assign((size_t)(mask.row1 - mask.row0 + 1) * maskWords, 0);
+
+		std::vector<float> crossings;
+		for (int row = mask.row0; row <= mask.row1; row++)
+		{
+			float y = m_origin.y + (row + 0.5f) * m_cellSize;
+
+			crossings.clear();
+			for (int i = 0; i < polygon.size(); i++)
+			{
+				const Vector3D &a = polygon[i];
+				const Vector3D &b = polygon[(i + 1) % polygon.size()];
+				if ((a.y <= y) != (b.y <= y))
+				{
+					crossings.push_back(a.x + (y - a.y) / (b.y - a.y) * (b.x - a.x));
+				}
+			}
+			std::sort(crossings.begin(), crossings.end());
+
+			unsigned long long *bits = &mask.bits[(size_t)(row - mask.row0) * maskWords];
+			for (int i = 0; i + 1 < crossings.size(); i += 2)
+			{
+				int c0 = std::max(col0, (int)ceil((crossings[i] - m_origin.x) / m_cellSize - 0.5f));
+				int c1 = std::min(col1, (int)floor((crossings[i + 1] - m_origin.x) / m_cellSize - 0.5f));
+				if (c0 <= c1)
+				{
+					fillSpan(bits, c0 - mask.word0 * 64, c1 - mask.word0 * 64);
+				}
+			}
+		}
+	}
+
+	// Sets bits [c0, c1], whole 64-bit words at a time in the middle
+	static void fillSpan(unsigned long long *bits, int c0, int c1)
+	{
+		int w0 = c0 / 64;
+		int w1 = c1 / 64;
+		unsigned long long first = ~0ull << (c0 % 64);
+		unsigned long long last = ~0ull >> (63 - c1 % 64);
+
+		if (w0 == w1)
+		{
+			bits[w0] |= first & last;
+			return;
+		}
+
+		bits[w0] |= first;
+		std::fill(bits + w0 + 1, bits + w1, ~0ull);
+		bits[w1] |= last;
+	}
+
+	template<typename F>
+	static void parallelFor(int count, int numThreads, F f)
+	{
+		std::atomic<int> next(0);
+		auto worker = [&]()
+		{
+			for (int i = next++; i < count; i = next++)
+			{
+				f(i);
+			}
+		};
+
+		std::vector<std::thread> threads;
+		for (int t = 1; t < std::min(numThreads, count); t++)
+		{
+			threads.push_back(std::thread(worker));
+		}
+
+		worker();
+
+		for (int t = 0; t < threads.size(); t++)
+		{
+			threads[t].join();
+		}
+	}
+private:
+	int m_width;
+	int m_height;
+	int m_wordsPerRow;
+	float m_cellSize;
+	Vector3D m_origin;
+	int m_numTeams;
+	// An emitter was removed since the last update
+	bool m_removed;
+	std::vector<FogEmitter> m_emitters;
+	std::unique_ptr<std::atomic<unsigned long long>[]> m_visible;
+	std::vector<unsigned long long> m_explored;
+};
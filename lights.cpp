@@ -0,0 +1,128 @@
+#pragma once
+#include "pch.h"
+#include "occluders.cpp"
+
+enum class Falloff
+{
+	Linear,
+	Quadratic,
+	Smooth
+};
+
+// Emitter with a finite reach. Walls that cannot touch the light's disc are
+// culled first, the fan is traced against the survivors only and every ray
+// is clipped to the radius, so the light polygon never leaves the disc.
+class LightEmitter
+{
+public:
+	LightEmitter() : pos(Vector3D(0.0f, 0.0f, 0.0f)), radius(8.0f), falloff(Falloff::Quadratic), numRays(100) {};
+	LightEmitter(const Vector3D &pos, float radius, Falloff falloff = Falloff::Quadratic, int numRays = 100) : pos(pos), radius(radius), falloff(falloff), numRays(numRays) {};
+
+	// Walls whose closest point lies within the light radius
+	void cull(const std::vector<Line> &walls)
+	{
+		candidates.clear();
+		for (int i = 0; i < walls.size(); i++)
+		{
+			if (reaches(walls[i]))
+			{
+				candidates.push_back(walls[i]);
+			}
+		}
+	}
+
+	// Same, but only looking at the grid cells under the light's disc
+	void cull(const OccluderGrid &grid)
+	{
+		const std::vector<Line> &lines = grid.scene().lines;
+
+		std::vector<int> indices;
+		grid.forEachCell(pos - Vector3D(radius, radius, 0.0f), pos + Vector3D(radius, radius, 0.0f), [&](int cell)
+		{
+			const int *first;
+			const int *last;
+			grid.cellItems<Line>(cell, first, last);
+			indices.insert(indices.end(), first, last);
+		});
+
+		std::sort(indices.begin(), indices.end());
+		indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+
+		candidates.clear();
+		for (int i = 0; i < indices.size(); i++)
+		{
+			if (reaches(lines[indices[i]]))
+			{
+				candidates.push_back(lines[indices[i]]);
+			}
+		}
+	}
+
+	// Fans numRays rays against the culled candidates; fills polygon with
+	// the clipped end points and intensity with the falloff at each of them
+	void trace()
+	{
+		polygon.resize(numRays);
+		intensity.resize(numRays);
+
+		for (int k = 0; k < numRays; k++)
+		{
+			float theta = 2 * M_PI * k / (float)numRays;
+			Vector3D direction(cos(theta), sin(theta), 0.0f);
+
+			float distance = radius;
+			for (int i = 0; i < candidates.size(); i++)
+			{
+				distance = std::min(distance, OccluderTraits<Line>::rayDistance(candidates[i], pos, direction));
+			}
+
+			polygon[k] = pos + direction * distance;
+			intensity[k] = attenuation(distance);
+		}
+	}
+
+	float attenuation(float distance) const
+	{
+		float x = std::max(0.0f, std::min(1.0f, 1.0f - distance / radius));
+
+		switch (falloff)
+		{
+		case Falloff::Linear:
+			return x;
+		case Falloff::Quadratic:
+			return x * x;
+		default:
+			return x * x * (3.0f - 2.0f * x);
+		}
+	}
+
+	// Fan lines from the centre to the clipped end points, for drawing
+	void fanLines(std::vector<Line> &lines) const
+	{
+		for (int k = 0; k < polygon.size(); k++)
+		{
+			lines.push_back(Line(pos, polygon[k]));
+		}
+	}
+public:
+	Vector3D pos;
+	float radius;
+	Falloff falloff;
+	int numRays;
+	std::vector<Line> candidates;
+	std::vector<Vector3D> polygon;
+	std::vector<float> intensity;
+private:
+	bool reaches(const Line &l) const
+	{
+		float lengthSquared = l.m_direction.dotProduct(l.m_direction);
+		float u = lengthSquared > 0.0f ? (pos - l.m_p1).dotProduct(l.m_direction) / lengthSquared : 0.0f;
+		u = std::max(0.0f, std::min(1.0f, u));
+
+		Vector3D closest = l.m_p1 + l.m_direction * u;
+		float dx = closest.x - pos.x;
+		float dy = closest.y - pos.y;
+
+		return dx * dx + dy * dy <= radius * radius;
+	}
+};
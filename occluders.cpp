@@ -0,0 +1,509 @@
+#pragma once
+#include "pch.h"
+#include "rayTracer.cpp"
+
+enum class OccluderType
+{
+	Line,
+	Disc,
+	Box,
+	Polygon,
+	Count
+};
+
+class Disc
+{
+public:
+	Disc() : center(Vector3D(0.0f, 0.0f, 0.0f)), r(1.0f) {};
+	Disc(const Vector3D &center, float r) : center(center), r(r) {};
+public:
+	Vector3D center;
+	float r;
+};
+
+class Box
+{
+public:
+	Box() {};
+	Box(const Vector3D &min, const Vector3D &max) : min(min), max(max) {};
+public:
+	Vector3D min;
+	Vector3D max;
+};
+
+class ConvexPolygon
+{
+public:
+	ConvexPolygon() {};
+	ConvexPolygon(const std::vector<Vector3D> &points) : points(points)
+	{
+		// Edge normals below assume counter-clockwise order
+		float area = 0.0f;
+		for (int i = 0; i < points.size(); i++)
+		{
+			const Vector3D &a = points[i];
+			const Vector3D &b = points[(i + 1) % points.size()];
+			area += a.x * b.y - b.x * a.y;
+		}
+
+		if (area < 0.0f)
+		{
+			std::reverse(this->points.begin(), this->points.end());
+		}
+	};
+public:
+	std::vector<Vector3D> points;
+};
+
+// Per-type ray kernels. Directions are unit length; rayDistance returns the
+// distance to the first hit or INFINITY, and 0 when the origin is inside.
+template<typename T>
+struct OccluderTraits;
+
+template<>
+struct OccluderTraits<Line>
+{
+	static const OccluderType type = OccluderType::Line;
+
+	static float rayDistance(const Line &l, const Vector3D &origin, const Vector3D &direction)
+	{
+		if (l.isBackFacing(origin))
+		{
+			return INFINITY;
+		}
+
+		float denom = direction.x * l.m_direction.y - direction.y * l.m_direction.x;
+		if (denom == 0.0f)
+		{
+			return INFINITY;
+		}
+
+		float ox = l.m_p1.x - origin.x;
+		float oy = l.m_p1.y - origin.y;
+		float t = (ox * l.m_direction.y - oy * l.m_direction.x) / denom;
+		float u = (ox * direction.y - oy * direction.x) / denom;
+
+		if (t < 0.0f || u < 0.0f || u > 1.0f)
+		{
+			return INFINITY;
+		}
+
+		return t;
+	}
+
+	static void bounds(const Line &l, Vector3D &min, Vector3D &max)
+	{
+		min = Vector3D(std::min(l.m_p1.x, l.m_p2.x), std::min(l.m_p1.y, l.m_p2.y), 0.0f);
+		max = Vector3D(std::max(l.m_p1.x, l.m_p2.x), std::max(l.m_p1.y, l.m_p2.y), 0.0f);
+	}
+};
+
+template<>
+struct OccluderTraits<Disc>
+{
+	static const OccluderType type = OccluderType::Disc;
+
+	static float rayDistance(const Disc &d, const Vector3D &origin, const Vector3D &direction)
+	{
+		float ox = origin.x - d.center.x;
+		float oy = origin.y - d.center.y;
+		float b = ox * direction.x + oy * direction.y;
+		float c = ox * ox + oy * oy - d.r * d.r;
+
+		if (c <= 0.0f)
+		{
+			return 0.0f;
+		}
+
+		float discriminant = b * b - c;
+		if (b > 0.0f || discriminant < 0.0f)
+		{
+			return INFINITY;
+		}
+
+		return -b - sqrt(discriminant);
+	}
+
+	static void bounds(const Disc &d, Vector3D &min, Vector3D &max)
+	{
+		min = Vector3D(d.center.x - d.r, d.center.y - d.r, 0.0f);
+		max = Vector3D(d.center.x + d.r, d.center.y + d.r, 0.0f);
+	}
+};
+
+template<>
+struct OccluderTraits<Box>
+{
+	static const OccluderType type = OccluderType::Box;
+
+	static float rayDistance(const Box &b, const Vector3D &origin, const Vector3D &direction)
+	{
+		float tMin = 0.0f;
+		float tMax = INFINITY;
+
+		if (!slab(origin.x, direction.x, b.min.x, b.max.x, tMin, tMax) ||
+			!slab(origin.y, direction.y, b.min.y, b.max.y, tMin, tMax))
+		{
+			return INFINITY;
+		}
+
+		return tMin;
+	}
+
+	static void bounds(const Box &b, Vector3D &min, Vector3D &max)
+	{
+		min = b.min;
+		max = b.max;
+	}
+
+	static bool slab(float origin, float direction, float min, float max, float &tMin, float &tMax)
+	{
+		if (direction == 0.0f)
+		{
+			return origin >= min && origin <= max;
+		}
+
+		float t1 = (min - origin) / direction;
+		float t2 = (max - origin) / direction;
+		tMin = std::max(tMin, std::min(t1, t2));
+		tMax = std::min(tMax, std::max(t1, t2));
+
+		return tMin <= tMax;
+	}
+};
+
+template<>
+struct OccluderTraits<ConvexPolygon>
+{
+	static const OccluderType type = OccluderType::Polygon;
+
+	// Cyrus-Beck clipping against the outward edge half-planes
+	static float rayDistance(const ConvexPolygon &p, const Vector3D &origin, const Vector3D &direction)
+	{
+		float tEnter = 0.0f;
+		float tExit = INFINITY;
+
+		int numPoints = (int)p.points.size();
+		for (int i = 0; i < numPoints; i++)
+		{
+			const Vector3D &a = p.points[i];
+			const Vector3D &b = p.points[(i + 1) % numPoints];
+
+			float nx = b.y - a.y;
+			float ny = a.x - b.x;
+			float distance = nx * (origin.x - a.x) + ny * (origin.y - a.y);
+			float speed = nx * direction.x + ny * direction.y;
+
+			if (speed == 0.0f)
+			{
+				if (distance > 0.0f)
+				{
+					return INFINITY;
+				}
+				continue;
+			}
+
+			float t = -distance / speed;
+			if (speed < 0.0f)
+			{
+				tEnter = std::max(tEnter, t);
+			}
+			else
+			{
+				tExit = std::min(tExit, t);
+			}
+
+			if (tEnter > tExit)
+			{
+				return INFINITY;
+			}
+		}
+
+		return tEnter;
+	}
+
+	static void bounds(const ConvexPolygon &p, Vector3D &min, Vector3D &max)
+	{
+		min = Vector3D(INFINITY, INFINITY, 0.0f);
+		max = Vector3D(-INFINITY, -INFINITY, 0.0f);
+		for (int i = 0; i < p.points.size(); i++)
+		{
+			min.x = std::min(min.x, p.points[i].x);
+			min.y = std::min(min.y, p.points[i].y);
+			max.x = std::max(max.x, p.points[i].x);
+			max.y = std::max(max.y, p.points[i].y);
+		}
+	}
+};
+
+// Occluders of every type, each kept in its own homogeneous array
+class OccluderScene
+{
+public:
+	template<typename T>
+	std::vector<T> &items();
+
+	template<typename T>
+	const std::vector<T> &items() const
+	{
+		return const_cast<OccluderScene *>(this)->items<T>();
+	}
+public:
+	std::vector<Line> lines;
+	std::vector<Disc> discs;
+	std::vector<Box> boxes;
+	std::vector<ConvexPolygon> polygons;
+};
+
+template<> inline std::vector<Line> &OccluderScene::items<Line>() { return lines; }
+template<> inline std::vector<Disc> &OccluderScene::items<Disc>() { return discs; }
+template<> inline std::vector<Box> &OccluderScene::items<Box>() { return boxes; }
+template<> inline std::vector<ConvexPolygon> &OccluderScene::items<ConvexPolygon>() { return polygons; }
+
+struct OccluderHit
+{
+	float distance;
+	OccluderType type;
+	int index;
+};
+
+// Uniform grid over every occluder type. Each cell keeps one index list per
+// type, so traversal calls the matching kernel directly without any virtual
+// dispatch.
+class OccluderGrid
+{
+public:
+	OccluderGrid() : m_scene(nullptr), m_cellSize(1.0f), m_cellsX(0), m_cellsY(0) {};
+
+	void build(const OccluderScene &scene, float cellSize = 0.0f)
+	{
+		m_scene = &scene;
+
+		int numItems = 0;
+		m_min = Vector3D(INFINITY, INFINITY, 0.0f);
+		m_max = Vector3D(-INFINITY, -INFINITY, 0.0f);
+		growBounds<Line>(numItems);
+		growBounds<Disc>(numItems);
+		growBounds<Box>(numItems);
+		growBounds<ConvexPolygon>(numItems);
+
+		if (numItems == 0)
+		{
+			m_min = Vector3D(0.0f, 0.0f, 0.0f);
+			m_max = Vector3D(1.0f, 1.0f, 0.0f);
+		}
+
+		float width = std::max(m_max.x - m_min.x, 1e-3f);
+		float height = std::max(m_max.y - m_min.y, 1e-3f);
+		if (cellSize <= 0.0f)
+		{
+			// Roughly two occluders per cell
+			cellSize = sqrt(width * height / std::max(1, numItems / 2));
+		}
+
+		m_cellSize = cellSize;
+		m_cellsX = std::max(1, std::min(4096, (int)ceil(width / cellSize)));
+		m_cellsY = std::max(1, std::min(4096, (int)ceil(height / cellSize)));
+		m_max = Vector3D(m_min.x + m_cellsX * cellSize, m_min.y + m_cellsY * cellSize, 0.0f);
+
+		insert<Line>();
+		insert<Disc>();
+		insert<Box>();
+		insert<ConvexPolygon>();
+	}
+
+	OccluderHit closestHit(const Vector3D &origin, const Vector3D &direction, float maxDistance) const
+	{
+		OccluderHit hit{ INFINITY, OccluderType::Count, -1 };
+
+		walk(origin, direction, maxDistance, [&](int cell, float cellExit)
+		{
+			testCell<Line>(cell, origin, direction, hit);
+			testCell<Disc>(cell, origin, direction, hit);
+			testCell<Box>(cell, origin, direction, hit);
+			testCell<ConvexPolygon>(cell, origin, direction, hit);
+
+			// Hits further than this cell may still be beaten in the next one
+			return hit.distance <= cellExit;
+		});
+
+		if (hit.distance > maxDistance)
+		{
+			hit = OccluderHit{ INFINITY, OccluderType::Count, -1 };
+		}
+
+		return hit;
+	}
+
+	// Same contract as Circle::pointMinRayMagnitude, for fan rays
+	float rayMagnitude(const Line &ray) const
+	{
+		Vector3D direction = ray.m_direction;
+		float length = direction.magnitude();
+		direction *= 1.0f / length;
+
+		return closestHit(ray.m_p1, direction, length).distance;
+	}
+
+	// Calls f(cell) for each cell overlapping the box [min, max]
+	template<typename F>
+	void forEachCell(const Vector3D &min, const Vector3D &max, F f) const
+	{
+		int x0, y0, x1, y1;
+		cellRange(min, max, x0, y0, x1, y1);
+
+		for (int y = y0; y <= y1; y++)
+		{
+			for (int x = x0; x <= x1; x++)
+			{
+				f(y * m_cellsX + x);
+			}
+		}
+	}
+
+	template<typename T>
+	void cellItems(int cell, const int *&first, const int *&last) const
+	{
+		int type = (int)OccluderTraits<T>::type;
+		first = m_cellItems[type].data() + m_cellStart[type][cell];
+		last = m_cellItems[type].data() + m_cellStart[type][cell + 1];
+	}
+
+	const OccluderScene &scene() const
+	{
+		return *m_scene;
+	}
+private:
+	template<typename T>
+	void growBounds(int &numItems)
+	{
+		const std::vector<T> &items = m_scene->items<T>();
+		for (int i = 0; i < items.size(); i++)
+		{
+			Vector3D min, max;
+			OccluderTraits<T>::bounds(items[i], min, max);
+
+			m_min.x = std::min(m_min.x, min.x);
+			m_min.y = std::min(m_min.y, min.y);
+			m_max.x = std::max(m_max.x, max.x);
+			m_max.y = std::max(m_max.y, max.y);
+		}
+		numItems += (int)items.size();
+	}
+
+	template<typename T>
+	void insert()
+	{
+		int type = (int)OccluderTraits<T>::type;
+		const std::vector<T> &items = m_scene->items<T>();
+		std::vector<int> &start = m_cellStart[type];
+		std::vector<int> &cellItems = m_cellItems[type];
+
+		// Count, prefix sum, then fill
+		start.assign(m_cellsX * m_cellsY + 1, 0);
+		for (int i = 0; i < items.size(); i++)
+		{
+			Vector3D min, max;
+			OccluderTraits<T>::bounds(items[i], min, max);
+			forEachCell(min, max, [&](int cell) { start[cell + 1]++; });
+		}
+
+		for (int c = 0; c < m_cellsX * m_cellsY; c++)
+		{
+			start[c + 1] += start[c];
+		}
+
+		cellItems.resize(start.back());
+		std::vector<int> fill(start.begin(), start.end() - 1);
+		for (int i = 0; i < items.size(); i++)
+		{
+			Vector3D min, max;
+			OccluderTraits<T>::bounds(items[i], min, max);
+			forEachCell(min, max, [&](int cell) { cellItems[fill[cell]++] = i; });
+		}
+	}
+
+	template<typename T>
+	void testCell(int cell, const Vector3D &origin, const Vector3D &direction, OccluderHit &hit) const
+	{
+		const std::vector<T> &items = m_scene->items<T>();
+
+		const int *first;
+		const int *last;
+		cellItems<T>(cell, first, last);
+		for (const int *i = first; i != last; i++)
+		{
+			float distance = OccluderTraits<T>::rayDistance(items[*i], origin, direction);
+			if (distance < hit.distance)
+			{
+				hit = OccluderHit{ distance, OccluderTraits<T>::type, *i };
+			}
+		}
+	}
+
+	void cellRange(const Vector3D &min, const Vector3D &max, int &x0, int &y0, int &x1, int &y1) const
+	{
+		x0 = std::max(0, std::min(m_cellsX - 1, (int)floor((min.x - m_min.x) / m_cellSize)));
+		y0 = std::max(0, std::min(m_cellsY - 1, (int)floor((min.y - m_min.y) / m_cellSize)));
+		x1 = std::max(0, std::min(m_cellsX - 1, (int)floor((max.x - m_min.x) / m_cellSize)));
+		y1 = std::max(0, std::min(m_cellsY - 1, (int)floor((max.y - m_min.y) / m_cellSize)));
+	}
+
+	// Amanatides-Woo walk; f(cell, cellExit) returns true to stop
+	template<typename F>
+	void walk(const Vector3D &origin, const Vector3D &direction, float maxDistance, F f) const
+	{
+		float tEnter = 0.0f;
+		float tExit = maxDistance;
+		if (!OccluderTraits<Box>::slab(origin.x, direction.x, m_min.x, m_max.x, tEnter, tExit) ||
+			!OccluderTraits<Box>::slab(origin.y, direction.y, m_min.y, m_max.y, tEnter, tExit))
+		{
+			return;
+		}
+
+		Vector3D p = origin + direction * tEnter;
+		int x = std::max(0, std::min(m_cellsX - 1, (int)floor((p.x - m_min.x) / m_cellSize)));
+		int y = std::max(0, std::min(m_cellsY - 1, (int)floor((p.y - m_min.y) / m_cellSize)));
+
+		int stepX = direction.x > 0.0f ? 1 : -1;
+		int stepY = direction.y > 0.0f ? 1 : -1;
+		float tDeltaX = direction.x != 0.0f ? m_cellSize / fabs(direction.x) : INFINITY;
+		float tDeltaY = direction.y != 0.0f ? m_cellSize / fabs(direction.y) : INFINITY;
+		float tMaxX = direction.x != 0.0f ? (m_min.x + (x + (stepX > 0)) * m_cellSize - origin.x) / direction.x : INFINITY;
+		float tMaxY = direction.y != 0.0f ? (m_min.y + (y + (stepY > 0)) * m_cellSize - origin.y) / direction.y : INFINITY;
+
+		while (true)
+		{
+			float cellExit = std::min(std::min(tMaxX, tMaxY), tExit);
+			if (f(y * m_cellsX + x, cellExit) || cellExit >= tExit)
+			{
+				return;
+			}
+
+			if (tMaxX < tMaxY)
+			{
+				x += stepX;
+				tMaxX += tDeltaX;
+			}
+			else
+			{
+				y += stepY;
+				tMaxY += tDeltaY;
+			}
+
+			if (x < 0 || y < 0 || x >= m_cellsX || y >= m_cellsY)
+			{
+				return;
+			}
+		}
+	}
+private:
+	const OccluderScene *m_scene;
+	Vector3D m_min;
+	Vector3D m_max;
+	float m_cellSize;
+	int m_cellsX;
+	int m_cellsY;
+	std::vector<int> m_cellStart[(int)OccluderType::Count];
+	std::vector<int> m_cellItems[(int)OccluderType::Count];
+};
@@ -1,68 +1,79 @@
-//
-// pch.h
-// Header for standard system include files.
-//
-
-#pragma once
-
-#include <winsdkver.h>
-#define _WIN32_WINNT 0x0601
-#include <sdkddkver.h>
-
-// Use the C++ standard templated min/max
-#define NOMINMAX
-
-// DirectX apps don't need GDI
-#define NODRAWTEXT
-#define NOGDI
-#define NOBITMAP
-
-// Include <mcx.h> if you need this
-#define NOMCX
-
-// Include <winsvc.h> if you need this
-#define NOSERVICE
-
-// WinHelp is deprecated
-#define NOHELP
-
-#define WIN32_LEAN_AND_MEAN
-#include <Windows.h>
-
-#include <wrl/client.h>
-
-#include <d3d11_1.h>
-#include <dxgi1_2.h>
-#include <DirectXMath.h>
-#include <DirectXColors.h>
-#include <d3dcompiler.h>
-
-#include <algorithm>
-#include <exception>
-#include <memory>
-#include <stdexcept>
-#include <string>
-#include <fstream>
-#include <sstream>
-#include <vector>
-#include <chrono>
-#include <thread>
-#include <math.h>
-
-#include "DDSTextureLoader.h"
-#include "SpriteBatch.h"
-#include "SimpleMath.h"
-
-using namespace DirectX;
-
-namespace DX
-{
-	inline void ThrowIfFailed(HRESULT hr)
-	{
-		if (FAILED(hr))
-		{
-			// Set a breakpoint on this line to catch DirectX API errors
-			throw std::exception();
-		}
-	}
-}
+//
+// pch.h
+// Header for standard system include files.
+//
+
+#pragma once
+
+// The ray tracing modules only need the standard library below; everything
+// Windows and DirectX is skipped so tools like benchmark.cpp build elsewhere
+#ifdef _WIN32
+#include <winsdkver.h>
+#define _WIN32_WINNT 0x0601
+#include <sdkddkver.h>
+
+// Use the C++ standard templated min/max
+#define NOMINMAX
+
+// DirectX apps don't need GDI
+#define NODRAWTEXT
+#define NOGDI
+#define NOBITMAP
+
+// Include <mcx.h> if you need this
+#define NOMCX
+
+// Include <winsvc.h> if you need this
+#define NOSERVICE
+
+// WinHelp is deprecated
+#define NOHELP
+
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+
+#include <wrl/client.h>
+
+#include <d3d11_1.h>
+#include <dxgi1_2.h>
+#include <DirectXMath.h>
+#include <DirectXColors.h>
+#include <d3dcompiler.h>
+#endif
+
+#include <algorithm>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <map>
+#include <math.h>
+#include <cstring>
+
+#ifdef _WIN32
+#include "DDSTextureLoader.h"
+#include "SpriteBatch.h"
+#include "SimpleMath.h"
+
+using namespace DirectX;
+
+namespace DX
+{
+	inline void ThrowIfFailed(HRESULT hr)
+	{
+		if (FAILED(hr))
+		{
+			// Set a breakpoint on this line to catch DirectX API errors
+			throw std::exception();
+		}
+	}
+}
+#endif
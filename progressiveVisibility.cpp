@@ -0,0 +1,531 @@
+#pragma once
+#include "pch.h"
+#include "occluders.cpp"
+
+struct ProgressiveEmitter
+{
+	int id;
+	Vector3D pos;
+	float basePriority;
+	float priority;
+	float motion;
+	float reach;
+	// Traced only as far as the bounds around the view it was started for
+	bool clipped;
+	bool requested;
+	Vector3D boundsMin;
+	Vector3D boundsMax;
+	int stride;
+	int next;
+	std::vector<float> distances;
+	std::vector<int> walls;
+	std::vector<char> traced;
+	// Rays whose fan distance and walls whose lit span may have changed since
+	// the last takeChanges()
+	std::vector<char> dirtyRays;
+	std::vector<int> dirtyWalls;
+};
+
+// Anytime visibility: every frame gets a budget in microseconds. Emitters
+// start from a coarse fan (every stride-th ray) and are refined by halving
+// the stride in priority order until the budget runs out; whatever is left
+// carries over to the next frame. Rays not traced yet are interpolated from
+// their traced neighbours, so every emitter always has a full fan.
+//
+// With a view rectangle set, emitters whose reach misses it are skipped and
+// the others trace their rays only to the view plus viewMargin on each side.
+// Gameplay that needs an emitter's real results calls request(), which
+// traces it in full wherever it is until it completes.
+class ProgressiveVisibility
+{
+public:
+	ProgressiveVisibility() : numRays(128), maxDistance(1024.0f), motionWeight(1.0f), viewWeight(1.0f), viewMargin(0.5f), batchSize(8), m_grid(nullptr), m_viewCenter(Vector3D(0.0f, 0.0f, 0.0f)), m_hasView(false), m_viewMin(Vector3D(0.0f, 0.0f, 0.0f)), m_viewMax(Vector3D(0.0f, 0.0f, 0.0f)), m_raysTraced(0), m_lastMicroseconds(0.0) {};
+
+	void setGrid(const OccluderGrid &grid)
+	{
+		m_grid = &grid;
+		for (int i = 0; i < m_emitters.size(); i++)
+		{
+			restart(m_emitters[i]);
+		}
+	}
+
+	// Moving an emitter starts its refinement again from the coarse fan. Rays
+	// never go further than reach.
+	void setEmitter(int id, const Vector3D &pos, float basePriority = 1.0f, float reach = INFINITY)
+	{
+		for (int i = 0; i < m_emitters.size(); i++)
+		{
+			ProgressiveEmitter &e = m_emitters[i];
+			if (e.id != id)
+			{
+				continue;
+			}
+
+			e.basePriority = basePriority;
+			if (e.pos != pos || e.reach != reach)
+			{
+				e.motion = (pos - e.pos).magnitude();
+				e.pos = pos;
+				e.reach = reach;
+				restart(e);
+			}
+			else
+			{
+				e.motion = 0.0f;
+			}
+			return;
+		}
+
+		ProgressiveEmitter e{ id, pos, basePriority, 0.0f, 0.0f, reach, false, false, pos, pos, 0, 0, {}, {}, {}, {}, {} };
+		restart(e);
+		m_emitters.push_back(e);
+	}
+
+	void removeEmitter(int id)
+	{
+		for (int i = 0; i < m_emitters.size(); i++)
+		{
+			if (m_emitters[i].id == id)
+			{
+				m_emitters.erase(m_emitters.begin() + i);
+				return;
+			}
+		}
+	}
+
+	// Emitters near this point are refined first
+	void setView(const Vector3D &center)
+	{
+		m_viewCenter = center;
+	}
+
+	// Also culls emitters and clips rays to the rectangle on screen
+	void setView(const Vector3D &min, const Vector3D &max)
+	{
+		m_hasView = true;
+		m_viewMin = min;
+		m_viewMax = max;
+		m_viewCenter = (min + max) * 0.5f;
+	}
+
+	// Gameplay wants this emitter's results: trace it in full, on screen or
+	// not, until it is complete. Call again after moving it.
+	void request(int id)
+	{
+		ProgressiveEmitter *e = find(id);
+		if (!e || e->requested)
+		{
+			return;
+		}
+
+		e->requested = true;
+		if (e->clipped)
+		{
+			restart(*e);
+		}
+	}
+
+	// Returns true when every emitter is fully refined
+	bool update(double budgetMicroseconds)
+	{
+		auto start = std::chrono::steady_clock::now();
+		auto deadline = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double, std::micro>(budgetMicroseconds));
+		m_raysTraced = 0;
+
+		std::vector<int> order;
+		for (int i = 0; i < m_emitters.size(); i++)
+		{
+			ProgressiveEmitter &e = m_emitters[i];
+			if (!e.requested && m_hasView)
+			{
+				if (!reachesView(e))
+				{
+					continue;
+				}
+
+				// The view left the bounds the emitter was clipped to
+				if (e.clipped && (m_viewMin.x < e.boundsMin.x || m_viewMin.y < e.boundsMin.y || m_viewMax.x > e.boundsMax.x || m_viewMax.y > e.boundsMax.y))
+				{
+					restart(e);
+				}
+			}
+
+			float viewDistance = (e.pos - m_viewCenter).magnitude();
+			e.priority = e.basePriority + motionWeight * e.motion + viewWeight / (1.0f + viewDistance);
+			order.push_back(i);
+		}
+
+		std::sort(order.begin(), order.end(), [&](int a, int b)
+		{
+			return m_emitters[a].priority > m_emitters[b].priority;
+		});
+
+		// First give every emitter its coarse fan, then refine
+		for (int pass = 0; pass < 2; pass++)
+		{
+			for (int i = 0; i < order.size(); i++)
+			{
+				ProgressiveEmitter &e = m_emitters[order[i]];
+				int coarseStride = initialStride();
+
+				while (e.stride > 0 && (pass == 1 || e.stride == coarseStride))
+				{
+					refine(e);
+
+					if (std::chrono::steady_clock::now() >= deadline)
+					{
+						m_lastMicroseconds = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+						return false;
+					}
+				}
+			}
+		}
+
+		m_lastMicroseconds = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+		return true;
+	}
+
+	// Hit distance for every ray of the fan, interpolated where not traced
+	void fan(int id, std::vector<float> &distances) const
+	{
+		const ProgressiveEmitter *e = find(id);
+		distances.assign(numRays, maxDistance);
+		if (!e)
+		{
+			return;
+		}
+
+		// Nearest traced ray on each side, wrapping around the fan
+		std::vector<int> previous(numRays, -1);
+		std::vector<int> following(numRays, -1);
+		int last = -1;
+		for (int pass = 0; pass < 2; pass++)
+		{
+			for (int i = 0; i < numRays; i++)
+			{
+				if (e->traced[i])
+				{
+					last = i;
+				}
+				previous[i] = last;
+			}
+		}
+		last = -1;
+		for (int pass = 0; pass < 2; pass++)
+		{
+			for (int i = numRays - 1; i >= 0; i--)
+			{
+				if (e->traced[i])
+				{
+					last = i;
+				}
+				following[i] = last;
+			}
+		}
+
+		for (int i = 0; i < numRays; i++)
+		{
+			if (e->traced[i] || previous[i] == -1)
+			{
+				distances[i] = e->traced[i] ? e->distances[i] : maxDistance;
+				continue;
+			}
+
+			int a = previous[i];
+			int b = following[i];
+			int gapA = (i - a + numRays) % numRays;
+			int gapB = (b - i + numRays) % numRays;
+			float w = (float)gapA / (gapA + gapB);
+			distances[i] = e->distances[a] * (1.0f - w) + e->distances[b] * w;
+		}
+	}
+
+	// Fan lines from a circle of radius r around the emitter, for drawing
+	void fanLines(int id, float r, std::vector<Line> &lines) const
+	{
+		const ProgressiveEmitter *e = find(id);
+		if (!e)
+		{
+			return;
+		}
+
+		std::vector<float> distances;
+		fan(id, distances);
+		for (int i = 0; i < numRays; i++)
+		{
+			Vector3D direction = this->direction(i);
+			lines.push_back(Line(e->pos + direction * r, e->pos + direction * std::max(r, distances[i])));
+		}
+	}
+
+	// The part of each wall between the outermost traced hits on it, in wall
+	// order
+	void litWalls(int id, std::vector<Line> &linesToDraw) const
+	{
+		std::vector<int> wallIndices;
+		litWalls(id, wallIndices, linesToDraw);
+	}
+
+	// Same, with the index of each lit wall in the grid's scene
+	void litWalls(int id, std::vector<int> &wallIndices, std::vector<Line> &linesToDraw) const
+	{
+		const ProgressiveEmitter *e = find(id);
+		if (!e || !m_grid)
+		{
+			return;
+		}
+
+		const std::vector<Line> &lines = m_grid->scene().lines;
+		std::map<int, std::pair<float, float>> spans;
+		for (int i = 0; i < numRays; i++)
+		{
+			int w = e->walls[i];
+			if (!e->traced[i] || w < 0)
+			{
+				continue;
+			}
+
+			const Line &l = lines[w];
+			Vector3D hit = e->pos + direction(i) * e->distances[i];
+			float u = (hit - l.m_p1).dotProduct(l.m_direction) / l.m_direction.dotProduct(l.m_direction);
+
+			auto it = spans.find(w);
+			if (it == spans.end())
+			{
+				spans[w] = std::make_pair(u, u);
+			}
+			else
+			{
+				it->second.first = std::min(it->second.first, u);
+				it->second.second = std::max(it->second.second, u);
+			}
+		}
+
+		for (auto it = spans.begin(); it != spans.end(); ++it)
+		{
+			const Line &l = lines[it->first];
+			wallIndices.push_back(it->first);
+			linesToDraw.push_back(Line(l.m_p1 + l.m_direction * it->second.first, l.m_p1 + l.m_direction * it->second.second));
+		}
+	}
+
+	// Hands over, and clears, the rays and walls that changed since the last
+	// call, so a renderer only rewrites those
+	void takeChanges(int id, std::vector<int> &rays, std::vector<int> &walls)
+	{
+		rays.clear();
+		walls.clear();
+
+		ProgressiveEmitter *e = find(id);
+		if (!e)
+		{
+			return;
+		}
+
+		for (int i = 0; i < e->dirtyRays.size(); i++)
+		{
+			if (e->dirtyRays[i])
+			{
+				rays.push_back(i);
+				e->dirtyRays[i] = 0;
+			}
+		}
+
+		std::sort(e->dirtyWalls.begin(), e->dirtyWalls.end());
+		e->dirtyWalls.erase(std::unique(e->dirtyWalls.begin(), e->dirtyWalls.end()), e->dirtyWalls.end());
+		walls.swap(e->dirtyWalls);
+		e->dirtyWalls.clear();
+	}
+
+	bool isComplete(int id) const
+	{
+		const ProgressiveEmitter *e = find(id);
+		return e && e->stride == 0;
+	}
+
+	// True when the fan ends at the view bounds rather than at the walls
+	bool isClipped(int id) const
+	{
+		const ProgressiveEmitter *e = find(id);
+		return e && e->clipped;
+	}
+
+	double lastMicroseconds() const
+	{
+		return m_lastMicroseconds;
+	}
+
+	int raysTraced() const
+	{
+		return m_raysTraced;
+	}
+public:
+	int numRays;
+	float maxDistance;
+	float motionWeight;
+	float viewWeight;
+	float viewMargin;
+	int batchSize;
+private:
+	int initialStride() const
+	{
+		int stride = 1;
+		while (stride * 2 <= numRays / 8)
+		{
+			stride *= 2;
+		}
+
+		return stride;
+	}
+
+	void restart(ProgressiveEmitter &e) const
+	{
+		e.clipped = m_hasView && !e.requested;
+		if (e.clipped)
+		{
+			Vector3D margin = (m_viewMax - m_viewMin) * viewMargin;
+			e.boundsMin = m_viewMin - margin;
+			e.boundsMax = m_viewMax + margin;
+		}
+
+		// Every ray moves, and every wall lit so far goes dark
+		for (int i = 0; i < e.walls.size(); i++)
+		{
+			if (e.walls[i] >= 0)
+			{
+				e.dirtyWalls.push_back(e.walls[i]);
+			}
+		}
+		e.dirtyRays.assign(numRays, 1);
+
+		e.stride = initialStride();
+		e.next = 0;
+		e.distances.assign(numRays, maxDistance);
+		e.walls.assign(numRays, -1);
+		e.traced.assign(numRays, 0);
+	}
+
+	// Traces up to batchSize new rays at the current stride
+	void refine(ProgressiveEmitter &e)
+	{
+		int traced = 0;
+		while (e.stride > 0 && traced < batchSize)
+		{
+			if (e.next >= numRays)
+			{
+				e.stride /= 2;
+				e.next = 0;
+				continue;
+			}
+
+			int i = e.next;
+			e.next += e.stride;
+			if (e.traced[i])
+			{
+				continue;
+			}
+
+			float length = traceLength(e, direction(i));
+			OccluderHit hit{ INFINITY, OccluderType::Count, -1 };
+			if (m_grid && length > 0.0f)
+			{
+				hit = m_grid->closestHit(e.pos, direction(i), length);
+			}
+
+			e.distances[i] = std::min(hit.distance, length);
+			e.walls[i] = hit.type == OccluderType::Line ? hit.index : -1;
+			e.traced[i] = 1;
+			markDirty(e, i);
+			traced++;
+		}
+
+		m_raysTraced += traced;
+
+		if (e.stride == 0)
+		{
+			e.requested = false;
+		}
+	}
+
+	// A new ray changes itself, the interpolated rays up to its traced
+	// neighbours and the wall it hit
+	void markDirty(ProgressiveEmitter &e, int i) const
+	{
+		if (e.walls[i] >= 0)
+		{
+			e.dirtyWalls.push_back(e.walls[i]);
+		}
+
+		e.dirtyRays[i] = 1;
+		for (int k = (i + 1) % numRays; k != i && !e.traced[k]; k = (k + 1) % numRays)
+		{
+			e.dirtyRays[k] = 1;
+		}
+		for (int k = (i - 1 + numRays) % numRays; k != i && !e.traced[k]; k = (k - 1 + numRays) % numRays)
+		{
+			e.dirtyRays[k] = 1;
+		}
+	}
+
+	// Reach, cut where the ray leaves the clip bounds
+	float traceLength(const ProgressiveEmitter &e, const Vector3D &direction) const
+	{
+		float tMin = 0.0f;
+		float tMax = std::min(maxDistance, e.reach);
+		if (!e.clipped)
+		{
+			return tMax;
+		}
+
+		if (!OccluderTraits<Box>::slab(e.pos.x, direction.x, e.boundsMin.x, e.boundsMax.x, tMin, tMax) ||
+			!OccluderTraits<Box>::slab(e.pos.y, direction.y, e.boundsMin.y, e.boundsMax.y, tMin, tMax))
+		{
+			return 0.0f;
+		}
+
+		return tMax;
+	}
+
+	bool reachesView(const ProgressiveEmitter &e) const
+	{
+		float dx = std::max(0.0f, std::max(m_viewMin.x - e.pos.x, e.pos.x - m_viewMax.x));
+		float dy = std::max(0.0f, std::max(m_viewMin.y - e.pos.y, e.pos.y - m_viewMax.y));
+		float reach = std::min(maxDistance, e.reach);
+
+		return dx * dx + dy * dy <= reach * reach;
+	}
+
+	Vector3D direction(int i) const
+	{
+		float theta = 2 * M_PI * i / (float)numRays;
+		return Vector3D(cos(theta), sin(theta), 0.0f);
+	}
+
+	const ProgressiveEmitter *find(int id) const
+	{
+		for (int i = 0; i < m_emitters.size(); i++)
+		{
+			if (m_emitters[i].id == id)
+			{
+				return &m_emitters[i];
+			}
+		}
+
+		return nullptr;
+	}
+
+	ProgressiveEmitter *find(int id)
+	{
+		return const_cast<ProgressiveEmitter *>(static_cast<const ProgressiveVisibility *>(this)->find(id));
+	}
+private:
+	const OccluderGrid *m_grid;
+	std::vector<ProgressiveEmitter> m_emitters;
+	Vector3D m_viewCenter;
+	bool m_hasView;
+	Vector3D m_viewMin;
+	Vector3D m_viewMax;
+	int m_raysTraced;
+	double m_lastMicroseconds;
+};
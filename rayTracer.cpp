@@ -1,349 +1,922 @@
-#include "pch.h"
-
-class Vector3D
-{
-public:
-	Vector3D() {};
-	Vector3D(float x, float y, float z) : x(x), y(y), z(z) {};
-
-	Vector3D operator-(const Vector3D &v) const
-	{
-		return Vector3D(x - v.x, y - v.y, z - v.z);
-	}
-
-	Vector3D &operator-=(const Vector3D &v)
-	{
-		x -= v.x;
-		y -= v.y;
-		z -= v.z;
-		return *this;
-	}
-
-	Vector3D operator+(const Vector3D &v) const
-	{
-		return Vector3D(x + v.x, y + v.y, z + v.z);
-	}
-
-	Vector3D &operator+=(const Vector3D &v)
-	{
-		x += v.x;
-		y += v.y;
-		z += v.z;
-		return *this;
-	}
-
-	Vector3D operator*(const float f) const
-	{
-		return Vector3D(x * f, y * f, z * f);
-	}
-
-	Vector3D &operator*(const Vector3D &v) const
-	{
-		return Vector3D(x * v.x, y * v.y, z * v.z);
-	}
-
-	Vector3D &operator*=(const Vector3D &v)
-	{
-		x *= v.x;
-		y *= v.y;
-		z *= v.z;
-		return *this;
-	}
-
-	Vector3D &operator*=(const float f)
-	{
-		x *= f;
-		y *= f;
-		z *= f;
-		return *this;
-	}
-
-	bool operator==(const Vector3D &v) const
-	{
-		if (!isNan() && !v.isNan())
-		{
-			if (x == v.x && y == v.y && z == v.z)
-			{
-				return true;
-			}
-			else
-			{
-				return false;
-			}
-		}
-		else
-		{
-			return false;
-		}
-	}
-
-	bool operator!=(const Vector3D &v) const
-	{
-		if (x != v.x || y != v.y || z != v.z)
-		{
-			return true;
-		}
-		else
-		{
-			return false;
-		}
-	}
-
-	bool isNan() const
-	{
-		if (isnan(x) || isnan(y) || isnan(z))
-		{
-			return true;
-		}
-		else
-		{
-			return false;
-		}
-	}
-
-	float magnitude()
-	{
-		return sqrt(x * x + y * y + z * z);
-	}
-
-	Vector3D &normalize()
-	{
-		float m = magnitude();
-		x /= m;
-		y /= m;
-		z /= m;
-		return *this;
-	}
-
-	float dotProduct(const Vector3D &v) const
-	{
-		return x * v.x + y * v.y;
-	}
-
-	Vector3D cross(const Vector3D &v) const
-	{
-		float tempX = y * v.z - z * v.y;
-		float tempY = z * v.x - x * v.z;
-		float tempZ = x * v.y - y * v.x;
-
-		return Vector3D(tempX, tempY, tempZ);
-	}
-public:
-	float x;
-	float y;
-	float z;
-};
-
-class Line
-{
-public:
-	Line() {};
-	Line(const Vector3D &p1, const Vector3D &p2) : m_p1(p1), m_p2(p2), m_direction(m_p2 - m_p1) {};
-
-	bool operator==(const Line &l) const
-	{
-		if (m_p1 == l.m_p1 && m_p2 == l.m_p2)
-		{
-			return true;
-		}
-		else
-		{
-			return false;
-		}
-	}
-
-	bool operator!=(const Line &l) const
-	{
-		if (m_p1 != l.m_p1 && m_p2 != l.m_p2)
-		{
-			return true;
-		}
-		else
-		{
-			return false;
-		}
-	}
-
-	Vector3D intersect(const Line &l) const
-	{
-		if (isIntersect(l))
-		{
-			Vector3D a1 = (l.m_p1 - m_p1).cross(l.m_direction);
-			Vector3D a2 = (l.m_p1 - m_p1).cross(m_direction);
-			Vector3D b = m_direction.cross(l.m_direction);
-
-			float t = 0;
-			float u = 0;
-			if (b.x != 0)
-			{
-				t = a1.x / b.x;
-				u = a2.x / b.x;
-			}
-			else if (b.y != 0)
-			{
-				t = a1.y / b.y;
-				u = a2.y / b.y;
-			}
-			else if (b.z != 0)
-			{
-				t = a1.z / b.z;
-				u = a2.z / b.z;
-			}
-
-			if ((t > 1.0f || t < 0.0f) || (u > 1.0f || u < 0.0f))
-			{
-				return Vector3D(NAN, NAN, NAN);
-			}
-
-			Vector3D v = m_p1 + (m_direction * t);
-
-			return v;
-		}
-		else
-		{
-			return Vector3D(NAN, NAN, NAN);
-		}
-	}
-public:
-	Vector3D m_p1;
-	Vector3D m_p2;
-	Vector3D m_direction;
-private:
-	bool isIntersect(const Line &l) const
-	{
-		Vector3D v = m_direction.cross(l.m_direction);
-
-		if (v.x == 0 && v.y == 0 && v.z == 0)
-		{
-			return false;
-		}
-		else
-		{
-			return true;
-		}
-	}
-};
-
-class Circle
-{
-public:
-	Circle() : pos(Vector3D(0.0f, 0.0f, 0.0f)), r(1.0f) {};
-	Circle(const Vector3D &pos, float r) : pos(pos), r(r) {};
-
-	void placePoints(int amount)
-	{
-		float step = 2 * M_PI / (float)amount;
-		for (float i = 0; i < 2 * M_PI; i += step)
-		{
-			Vector3D a = placePoint2D(i);
-			Vector3D b = normal2D(a);
-
-			Vector3D direction = b - a;
-			b = b + direction * 1024.0f;
-
-			circleLines.push_back(Line(a, b));
-		}
-	}
-
-	float pointMinRayMagnitude(const Line &ray, const std::vector<Line> &lines) const
-	{
-		float resultDistance = INFINITY;
-
-		float minRayDistance = (ray.m_p2 - ray.m_p1).magnitude();
-		for (int j = 0; j < lines.size(); j++)
-		{
-			Line l = lines[j];
-
-			Vector3D intersectPoint = ray.intersect(l);
-
-			if (!intersectPoint.isNan())
-			{
-				float rayDistance = (intersectPoint - ray.m_p1).magnitude();
-
-				if (rayDistance < minRayDistance)
-				{
-					minRayDistance = rayDistance;
-
-					resultDistance = rayDistance;
-				}
-			}
-		}
-
-		return resultDistance;
-	}
-
-	void intersectPoints(const std::vector<Line> &lines, std::vector<Line> &linesToDraw)
-	{
-		for (int i = 0; i < lines.size(); i++)
-		{
-			Line l = lines[i];
-			Line newL = l;
-
-			float minDistanceA = (l.m_p2 - l.m_p1).magnitude();
-			float minDistanceB = (l.m_p1 - l.m_p2).magnitude();
-			for (int j = 0; j < circleLines.size(); j++)
-			{
-				Line &circleLine = circleLines[j];
-
-				Vector3D intersectPoint = circleLine.intersect(l);
-
-				if (!intersectPoint.isNan())
-				{
-					float rayMagnitude = (intersectPoint - circleLine.m_p1).magnitude();
-					float minRayMagnitude = pointMinRayMagnitude(circleLine, lines);
-
-					if (rayMagnitude == minRayMagnitude)
-					{
-						circleLine.m_p2 = intersectPoint;
-
-						float vectorMagnitudeA = (intersectPoint - l.m_p1).magnitude();
-						float vectorMagnitudeB = (intersectPoint - l.m_p2).magnitude();
-
-						if (vectorMagnitudeA < vectorMagnitudeB)
-						{
-							if (vectorMagnitudeA < minDistanceA)
-							{
-								newL.m_p1 = intersectPoint;
-
-								minDistanceA = vectorMagnitudeA;
-							}
-						}
-						else
-						{
-							if (vectorMagnitudeB < minDistanceB)
-							{
-								newL.m_p2 = intersectPoint;
-
-								minDistanceB = vectorMagnitudeB;
-							}
-						}
-					}
-				}
-			}
-			if (l != newL)
-			{
-				linesToDraw.push_back(newL);
-			}
-		}
-	}
-public:
-	Vector3D pos;
-	float r;
-	std::vector<Line> circleLines;
-private:
-	Vector3D placePoint2D(float theta) const
-	{
-		float tempX = pos.x + r * cos(theta);
-		float tempY = pos.y + r * sin(theta);
-
-		return Vector3D(tempX, tempY, 0.0f);
-	}
-
-	Vector3D normal2D(const Vector3D &point) const
-	{
-		float tempX = 2.0f * point.x - pos.x;
-		float tempY = 2.0f * point.y - pos.y;
-
-		return Vector3D(tempX, tempY, 0.0f);
-	}
-};
\ No newline at end of file
+#pragma once
+#include "pch.h"
+
+class Vector3D
+{
+public:
+	Vector3D() {};
+	Vector3D(float x, float y, float z) : x(x), y(y), z(z) {};
+
+	Vector3D operator-(const Vector3D &v) const
+	{
+		return Vector3D(x - v.x, y - v.y, z - v.z);
+	}
+
+	Vector3D &operator-=(const Vector3D &v)
+	{
+		x -= v.x;
+		y -= v.y;
+		z -= v.z;
+		return *this;
+	}
+
+	Vector3D operator+(const Vector3D &v) const
+	{
+		return Vector3D(x + v.x, y + v.y, z + v.z);
+	}
+
+	Vector3D &operator+=(const Vector3D &v)
+	{
+		x += v.x;
+		y += v.y;
+		z += v.z;
+		return *this;
+	}
+
+	Vector3D operator*(const float f) const
+	{
+		return Vector3D(x * f, y * f, z * f);
+	}
+
+	Vector3D operator*(const Vector3D &v) const
+	{
+		return Vector3D(x * v.x, y * v.y, z * v.z);
+	}
+
+	Vector3D &operator*=(const Vector3D &v)
+	{
+		x *= v.x;
+		y *= v.y;
+		z *= v.z;
+		return *this;
+	}
+
+	Vector3D &operator*=(const float f)
+	{
+		x *= f;
+		y *= f;
+		z *= f;
+		return *this;
+	}
+
+	bool operator==(const Vector3D &v) const
+	{
+		if (!isNan() && !v.isNan())
+		{
+			if (x == v.x && y == v.y && z == v.z)
+			{
+				return true;
+			}
+			else
+			{
+				return false;
+			}
+		}
+		else
+		{
+			return false;
+		}
+	}
+
+	bool operator!=(const Vector3D &v) const
+	{
+		if (x != v.x || y != v.y || z != v.z)
+		{
+			return true;
+		}
+		else
+		{
+			return false;
+		}
+	}
+
+	bool isNan() const
+	{
+		if (isnan(x) || isnan(y) || isnan(z))
+		{
+			return true;
+		}
+		else
+		{
+			return false;
+		}
+	}
+
+	float magnitude()
+	{
+		return sqrt(x * x + y * y + z * z);
+	}
+
+	Vector3D &normalize()
+	{
+		float m = magnitude();
+		x /= m;
+		y /= m;
+		z /= m;
+		return *this;
+	}
+
+	float dotProduct(const Vector3D &v) const
+	{
+		return x * v.x + y * v.y;
+	}
+
+	Vector3D cross(const Vector3D &v) const
+	{
+		float tempX = y * v.z - z * v.y;
+		float tempY = z * v.x - x * v.z;
+		float tempZ = x * v.y - y * v.x;
+
+		return Vector3D(tempX, tempY, tempZ);
+	}
+public:
+	float x;
+	float y;
+	float z;
+};
+
+class Line
+{
+public:
+	Line() : m_oneSided(false) {};
+	Line(const Vector3D &p1, const Vector3D &p2, bool oneSided = false) : m_p1(p1), m_p2(p2), m_direction(m_p2 - m_p1), m_oneSided(oneSided) {};
+
+	bool operator==(const Line &l) const
+	{
+		if (m_p1 == l.m_p1 && m_p2 == l.m_p2)
+		{
+			return true;
+		}
+		else
+		{
+			return false;
+		}
+	}
+
+	bool operator!=(const Line &l) const
+	{
+		if (m_p1 != l.m_p1 && m_p2 != l.m_p2)
+		{
+			return true;
+		}
+		else
+		{
+			return false;
+		}
+	}
+
+	Vector3D intersect(const Line &l) const
+	{
+		if (isIntersect(l))
+		{
+			Vector3D a1 = (l.m_p1 - m_p1).cross(l.m_direction);
+			Vector3D a2 = (l.m_p1 - m_p1).cross(m_direction);
+			Vector3D b = m_direction.cross(l.m_direction);
+
+			float t = 0;
+			float u = 0;
+			if (b.x != 0)
+			{
+				t = a1.x / b.x;
+				u = a2.x / b.x;
+			}
+			else if (b.y != 0)
+			{
+				t = a1.y / b.y;
+				u = a2.y / b.y;
+			}
+			else if (b.z != 0)
+			{
+				t = a1.z / b.z;
+				u = a2.z / b.z;
+			}
+
+			if ((t > 1.0f || t < 0.0f) || (u > 1.0f || u < 0.0f))
+			{
+				return Vector3D(NAN, NAN, NAN);
+			}
+
+			Vector3D v = m_p1 + (m_direction * t);
+
+			return v;
+		}
+		else
+		{
+			return Vector3D(NAN, NAN, NAN);
+		}
+	}
+public:
+	Vector3D m_p1;
+	Vector3D m_p2;
+	Vector3D m_direction;
+	// One-sided walls only face the left of m_p1 -> m_p2
+	bool m_oneSided;
+public:
+	// True when point sees the back of a one-sided wall. One-sided walls only
+	// come from solid outlines facing outwards, so from any point outside the
+	// solid that back is behind a front face and the wall can be skipped for
+	// every ray starting at point. Ray kernels test it against the ray's own
+	// start point and nothing else.
+	bool isBackFacing(const Vector3D &point) const
+	{
+		return m_oneSided && m_direction.x * (point.y - m_p1.y) - m_direction.y * (point.x - m_p1.x) < 0.0f;
+	}
+
+	// Closed outline: a solid pillar becomes one-sided walls facing outwards,
+	// whatever order the points come in. A room stays two-sided, since its
+	// walls can be seen from outside as well as from inside.
+	static void addClosedLoop(const std::vector<Vector3D> &points, bool solid, std::vector<Line> &lines)
+	{
+		if (!solid)
+		{
+			for (int i = 0; i < points.size(); i++)
+			{
+				lines.push_back(Line(points[i], points[(i + 1) % points.size()]));
+			}
+			return;
+		}
+
+		float area = 0.0f;
+		for (int i = 0; i < points.size(); i++)
+		{
+			const Vector3D &a = points[i];
+			const Vector3D &b = points[(i + 1) % points.size()];
+			area += a.x * b.y - b.x * a.y;
+		}
+
+		// Clockwise keeps the outside on the left
+		bool reverse = area > 0.0f;
+		for (int i = 0; i < points.size(); i++)
+		{
+			const Vector3D &a = points[i];
+			const Vector3D &b = points[(i + 1) % points.size()];
+			lines.push_back(reverse ? Line(b, a, true) : Line(a, b, true));
+		}
+	}
+private:
+	bool isIntersect(const Line &l) const
+	{
+		Vector3D v = m_direction.cross(l.m_direction);
+
+		if (v.x == 0 && v.y == 0 && v.z == 0)
+		{
+			return false;
+		}
+		else
+		{
+			return true;
+		}
+	}
+};
+
+// Walls binned by the angle they cover as seen from one emitter. Every
+// bucket lists its walls nearest first, so a ray of the emitter's fan only
+// tests the walls in its direction and stops as soon as the next wall cannot
+// be closer than the hit it already has. Cheap enough to rebuild every frame
+// for an emitter that moves.
+class AngularBuckets
+{
+public:
+	AngularBuckets() : m_lines(nullptr), m_origin(Vector3D(0.0f, 0.0f, 0.0f)), m_numBuckets(0), m_bucketAngle(0.0f) {};
+
+	// Rays are expected to start at origin or further out along their own
+	// direction. Back faces are skipped per ray, by the same test as
+	// Circle::pointMinRayMagnitude, so no wall is culled here.
+	void build(const Vector3D &origin, const std::vector<Line> &lines, int numBuckets)
+	{
+		const float margin = 1e-4f;
+
+		m_lines = &lines;
+		m_origin = origin;
+		m_numBuckets = std::max(1, numBuckets);
+		m_bucketAngle = 2 * M_PI / m_numBuckets;
+
+		std::vector<int> firstBucket(lines.size(), 0);
+		std::vector<int> numCovered(lines.size(), 0);
+		std::vector<float> nearDistance(lines.size(), 0.0f);
+		m_bucketStart.assign(m_numBuckets + 1, 0);
+
+		for (int i = 0; i < lines.size(); i++)
+		{
+			const Line &l = lines[i];
+			Vector3D a = l.m_p1 - origin;
+			Vector3D b = l.m_p2 - origin;
+			float cross = a.x * b.y - a.y * b.x;
+			float lengthSquared = l.m_direction.dotProduct(l.m_direction);
+			float u = lengthSquared > 0.0f ? std::max(0.0f, std::min(1.0f, -a.dotProduct(l.m_direction) / lengthSquared)) : 0.0f;
+			Vector3D closest = a + l.m_direction * u;
+			nearDistance[i] = closest.magnitude();
+
+			if (nearDistance[i] <= 1e-6f)
+			{
+				// Through the origin: it can be anywhere in the fan
+				numCovered[i] = m_numBuckets;
+			}
+			else
+			{
+				float start = atan2(a.y, a.x);
+				float extent = atan2(cross, a.dotProduct(b));
+				if (extent < 0.0f)
+				{
+					start += extent;
+					extent = -extent;
+				}
+				if (start < 0.0f)
+				{
+					start += 2 * M_PI;
+				}
+
+				int first = (int)floor((start - margin) / m_bucketAngle);
+				int last = (int)floor((start + extent + margin) / m_bucketAngle);
+				firstBucket[i] = (first % m_numBuckets + m_numBuckets) % m_numBuckets;
+				numCovered[i] = std::min(m_numBuckets, last - first + 1);
+			}
+
+			for (int k = 0; k < numCovered[i]; k++)
+			{
+				m_bucketStart[(firstBucket[i] + k) % m_numBuckets + 1]++;
+			}
+		}
+
+		for (int k = 0; k < m_numBuckets; k++)
+		{
+			m_bucketStart[k + 1] += m_bucketStart[k];
+		}
+
+		m_items.resize(m_bucketStart[m_numBuckets]);
+		std::vector<int> fill(m_bucketStart.begin(), m_bucketStart.end() - 1);
+		for (int i = 0; i < lines.size(); i++)
+		{
+			for (int k = 0; k < numCovered[i]; k++)
+			{
+				int bucket = (firstBucket[i] + k) % m_numBuckets;
+				// Slightly under, so rounding never ends a search too early
+				m_items[fill[bucket]++] = std::make_pair(nearDistance[i] * (1.0f - 1e-5f), i);
+			}
+		}
+
+		for (int k = 0; k < m_numBuckets; k++)
+		{
+			std::sort(m_items.begin() + m_bucketStart[k], m_items.begin() + m_bucketStart[k + 1]);
+		}
+	}
+
+	// Same result as Circle::pointMinRayMagnitude over all the walls
+	float rayMagnitude(const Line &ray) const
+	{
+		float resultDistance = INFINITY;
+		if (!m_lines)
+		{
+			return resultDistance;
+		}
+
+		Vector3D direction = ray.m_p2 - ray.m_p1;
+		float theta = atan2(direction.y, direction.x);
+		if (theta < 0.0f)
+		{
+			theta += 2 * M_PI;
+		}
+		int bucket = std::max(0, std::min(m_numBuckets - 1, (int)(theta / m_bucketAngle)));
+
+		// A wall cannot be hit closer than its distance from the origin minus
+		// how far out the ray starts
+		float offset = (ray.m_p1 - m_origin).magnitude();
+		float minRayDistance = direction.magnitude();
+		for (int i = m_bucketStart[bucket]; i < m_bucketStart[bucket + 1]; i++)
+		{
+			if (m_items[i].first - offset > minRayDistance)
+			{
+				break;
+			}
+
+			const Line &l = (*m_lines)[m_items[i].second];
+			if (l.isBackFacing(ray.m_p1))
+			{
+				continue;
+			}
+
+			Vector3D intersectPoint = ray.intersect(l);
+
+			if (!intersectPoint.isNan())
+			{
+				float rayDistance = (intersectPoint - ray.m_p1).magnitude();
+
+				if (rayDistance < minRayDistance)
+				{
+					minRayDistance = rayDistance;
+
+					resultDistance = rayDistance;
+				}
+			}
+		}
+
+		return resultDistance;
+	}
+
+	int numBuckets() const
+	{
+		return m_numBuckets;
+	}
+private:
+	const std::vector<Line> *m_lines;
+	Vector3D m_origin;
+	int m_numBuckets;
+	float m_bucketAngle;
+	std::vector<int> m_bucketStart;
+	std::vector<std::pair<float, int>> m_items;
+};
+
+class Circle
+{
+public:
+	Circle() : pos(Vector3D(0.0f, 0.0f, 0.0f)), r(1.0f) {};
+	Circle(const Vector3D &pos, float r) : pos(pos), r(r) {};
+
+	void placePoints(int amount)
+	{
+		float step = 2 * M_PI / (float)amount;
+		for (float i = 0; i < 2 * M_PI; i += step)
+		{
+			Vector3D a = placePoint2D(i);
+			Vector3D b = normal2D(a);
+
+			Vector3D direction = b - a;
+			b = b + direction * 1024.0f;
+
+			circleLines.push_back(Line(a, b));
+		}
+	}
+
+	float pointMinRayMagnitude(const Line &ray, const std::vector<Line> &lines) const
+	{
+		float resultDistance = INFINITY;
+
+		float minRayDistance = (ray.m_p2 - ray.m_p1).magnitude();
+		for (int j = 0; j < lines.size(); j++)
+		{
+			Line l = lines[j];
+
+			if (l.isBackFacing(ray.m_p1))
+			{
+				continue;
+			}
+
+			Vector3D intersectPoint = ray.intersect(l);
+
+			if (!intersectPoint.isNan())
+			{
+				float rayDistance = (intersectPoint - ray.m_p1).magnitude();
+
+				if (rayDistance < minRayDistance)
+				{
+					minRayDistance = rayDistance;
+
+					resultDistance = rayDistance;
+				}
+			}
+		}
+
+		return resultDistance;
+	}
+
+	void intersectPoints(const std::vector<Line> &lines, std::vector<Line> &linesToDraw)
+	{
+		// Each ray only looks at the walls in its own direction
+		AngularBuckets buckets;
+		buckets.build(pos, lines, (int)circleLines.size());
+
+		for (int i = 0; i < lines.size(); i++)
+		{
+			Line l = lines[i];
+			Line newL = l;
+
+			float minDistanceA = (l.m_p2 - l.m_p1).magnitude();
+			float minDistanceB = (l.m_p1 - l.m_p2).magnitude();
+			for (int j = 0; j < circleLines.size(); j++)
+			{
+				Line &circleLine = circleLines[j];
+
+				if (l.isBackFacing(circleLine.m_p1))
+				{
+					continue;
+				}
+
+				Vector3D intersectPoint = circleLine.intersect(l);
+
+				if (!intersectPoint.isNan())
+				{
+					float rayMagnitude = (intersectPoint - circleLine.m_p1).magnitude();
+					float minRayMagnitude = buckets.rayMagnitude(circleLine);
+
+					if (rayMagnitude == minRayMagnitude)
+					{
+						circleLine.m_p2 = intersectPoint;
+
+						float vectorMagnitudeA = (intersectPoint - l.m_p1).magnitude();
+						float vectorMagnitudeB = (intersectPoint - l.m_p2).magnitude();
+
+						if (vectorMagnitudeA < vectorMagnitudeB)
+						{
+							if (vectorMagnitudeA < minDistanceA)
+							{
+								newL.m_p1 = intersectPoint;
+
+								minDistanceA = vectorMagnitudeA;
+							}
+						}
+						else
+						{
+							if (vectorMagnitudeB < minDistanceB)
+							{
+								newL.m_p2 = intersectPoint;
+
+								minDistanceB = vectorMagnitudeB;
+							}
+						}
+					}
+				}
+			}
+			if (l != newL)
+			{
+				linesToDraw.push_back(newL);
+			}
+		}
+	}
+public:
+	Vector3D pos;
+	float r;
+	std::vector<Line> circleLines;
+private:
+	Vector3D placePoint2D(float theta) const
+	{
+		float tempX = pos.x + r * cos(theta);
+		float tempY = pos.y + r * sin(theta);
+
+		return Vector3D(tempX, tempY, 0.0f);
+	}
+
+	Vector3D normal2D(const Vector3D &point) const
+	{
+		float tempX = 2.0f * point.x - pos.x;
+		float tempY = 2.0f * point.y - pos.y;
+
+		return Vector3D(tempX, tempY, 0.0f);
+	}
+};
+
+enum class BounceType
+{
+	Specular,
+	Diffuse
+};
+
+struct BounceRay
+{
+	Vector3D origin;
+	Vector3D direction;
+	int depth;
+	int ignoreWall;
+	unsigned int seed;
+	unsigned long long key;
+};
+
+// Traces bounded-depth wall bounces one generation at a time. Every generation
+// lives in a compact queue that is sorted by origin cell and direction before
+// it is traced, so neighbouring rays hit the same walls back to back, and is
+// split into contiguous runs across threads.
+class WavefrontTracer
+{
+public:
+	WavefrontTracer() : maxDepth(2), type(BounceType::Specular), rayLength(1024.0f), cellSize(4.0f), numThreads(0) {};
+	WavefrontTracer(int maxDepth, BounceType type) : maxDepth(maxDepth), type(type), rayLength(1024.0f), cellSize(4.0f), numThreads(0) {};
+
+	void trace(const std::vector<Line> &primaryRays, const std::vector<Line> &walls, std::vector<Line> &segmentsToDraw)
+	{
+		m_queue.clear();
+		for (int i = 0; i < primaryRays.size(); i++)
+		{
+			const Line &ray = primaryRays[i];
+
+			Vector3D direction = ray.m_p2 - ray.m_p1;
+			direction.normalize();
+
+			m_queue.push_back(BounceRay{ ray.m_p1, direction, 0, -1, (unsigned int)i * 2654435761u, 0 });
+		}
+
+		while (!m_queue.empty())
+		{
+			sortQueue();
+			traceGeneration(walls);
+
+			// Joined in queue order, so the result does not depend on the
+			// number of threads
+			m_nextQueue.clear();
+			for (int t = 0; t < m_segments.size(); t++)
+			{
+				segmentsToDraw.insert(segmentsToDraw.end(), m_segments[t].begin(), m_segments[t].end());
+				m_nextQueue.insert(m_nextQueue.end(), m_bounces[t].begin(), m_bounces[t].end());
+			}
+
+			std::swap(m_queue, m_nextQueue);
+		}
+	}
+public:
+	int maxDepth;
+	BounceType type;
+	float rayLength;
+	float cellSize;
+	// 0 uses every hardware thread
+	int numThreads;
+private:
+	// Each thread takes a contiguous run of the sorted queue, which keeps
+	// the rays it traces together close in space and direction
+	void traceGeneration(const std::vector<Line> &walls)
+	{
+		int count = (int)m_queue.size();
+		int threadCount = numThreads > 0 ? numThreads : std::max(1, (int)std::thread::hardware_concurrency());
+		threadCount = std::max(1, std::min(threadCount, count / 64));
+
+		m_segments.resize(threadCount);
+		m_bounces.resize(threadCount);
+
+		auto worker = [this, &walls, count, threadCount](int t)
+		{
+			m_segments[t].clear();
+			m_bounces[t].clear();
+
+			int begin = (int)((long long)count * t / threadCount);
+			int end = (int)((long long)count * (t + 1) / threadCount);
+			for (int i = begin; i < end; i++)
+			{
+				traceRay(m_queue[i], walls, m_segments[t], m_bounces[t]);
+			}
+		};
+
+		std::vector<std::thread> threads;
+		for (int t = 1; t < threadCount; t++)
+		{
+			threads.push_back(std::thread(worker, t));
+		}
+
+		worker(0);
+
+		for (int t = 0; t < threads.size(); t++)
+		{
+			threads[t].join();
+		}
+	}
+
+	void sortQueue()
+	{
+		for (int i = 0; i < m_queue.size(); i++)
+		{
+			BounceRay &ray = m_queue[i];
+
+			// 16 bits per cell axis, 16 bits of direction angle
+			unsigned long long cellX = (unsigned short)(int)floor(ray.origin.x / cellSize);
+			unsigned long long cellY = (unsigned short)(int)floor(ray.origin.y / cellSize);
+			float angle = atan2(ray.direction.y, ray.direction.x) + M_PI;
+			unsigned long long angleBucket = (unsigned short)(angle / (2 * M_PI) * 65535.0f);
+
+			ray.key = (cellY << 32) | (cellX << 16) | angleBucket;
+		}
+
+		std::sort(m_queue.begin(), m_queue.end(), [](const BounceRay &a, const BounceRay &b)
+		{
+			return a.key < b.key;
+		});
+	}
+
+	void traceRay(const BounceRay &ray, const std::vector<Line> &walls, std::vector<Line> &segmentsToDraw, std::vector<BounceRay> &bounces) const
+	{
+		Line segment(ray.origin, ray.origin + ray.direction * rayLength);
+
+		int hitWall = -1;
+		float minDistance = rayLength;
+		Vector3D hitPoint = segment.m_p2;
+		for (int j = 0; j < walls.size(); j++)
+		{
+			if (j == ray.ignoreWall || walls[j].isBackFacing(ray.origin))
+			{
+				continue;
+			}
+
+			Vector3D intersectPoint = segment.intersect(walls[j]);
+
+			if (!intersectPoint.isNan())
+			{
+				float distance = (intersectPoint - ray.origin).magnitude();
+
+				if (distance < minDistance)
+				{
+					minDistance = distance;
+					hitPoint = intersectPoint;
+					hitWall = j;
+				}
+			}
+		}
+
+		segmentsToDraw.push_back(Line(ray.origin, hitPoint));
+
+		if (hitWall == -1 || ray.depth >= maxDepth)
+		{
+			return;
+		}
+
+		const Line &wall = walls[hitWall];
+		Vector3D normal(-wall.m_direction.y, wall.m_direction.x, 0.0f);
+		normal.normalize();
+		if (normal.dotProduct(ray.direction) > 0.0f)
+		{
+			normal *= -1.0f;
+		}
+
+		BounceRay bounce = ray;
+		bounce.origin = hitPoint;
+		bounce.depth = ray.depth + 1;
+		bounce.ignoreWall = hitWall;
+
+		if (type == BounceType::Specular)
+		{
+			bounce.direction = ray.direction - normal * (2.0f * ray.direction.dotProduct(normal));
+		}
+		else
+		{
+			// Lambertian in 2D: the sine of the angle to the normal is uniform
+			bounce.seed = ray.seed * 1664525u + 1013904223u;
+			float u = (bounce.seed >> 8) / 16777216.0f;
+			float s = 2.0f * u - 1.0f;
+			float c = sqrt(1.0f - s * s);
+
+			Vector3D tangent(-normal.y, normal.x, 0.0f);
+			bounce.direction = normal * c + tangent * s;
+		}
+
+		bounces.push_back(bounce);
+	}
+private:
+	std::vector<BounceRay> m_queue;
+	std::vector<BounceRay> m_nextQueue;
+	std::vector<std::vector<Line>> m_segments;
+	std::vector<std::vector<BounceRay>> m_bounces;
+};
+
+
+// Walls flattened to structure-of-arrays 2D start points and directions, so
+// the inner loops of the batch queries run over contiguous floats.
+class WallBuffer
+{
+public:
+	WallBuffer() {};
+	WallBuffer(const std::vector<Line> &lines)
+	{
+		build(lines);
+	}
+
+	void build(const std::vector<Line> &lines)
+	{
+		x.resize(lines.size());
+		y.resize(lines.size());
+		dx.resize(lines.size());
+		dy.resize(lines.size());
+
+		for (int i = 0; i < lines.size(); i++)
+		{
+			x[i] = lines[i].m_p1.x;
+			y[i] = lines[i].m_p1.y;
+			dx[i] = lines[i].m_direction.x;
+			dy[i] = lines[i].m_direction.y;
+		}
+	}
+
+	int size() const
+	{
+		return (int)x.size();
+	}
+public:
+	std::vector<float> x;
+	std::vector<float> y;
+	std::vector<float> dx;
+	std::vector<float> dy;
+};
+
+// Occlusion-only queries: a pair is visible when no wall crosses the open
+// segment between its two points. Nothing is built per query, the walls are
+// read straight from a WallBuffer.
+class LineOfSight
+{
+public:
+	static const int blockSize = 8;
+
+	static bool isVisible(const Vector3D &from, const Vector3D &to, const WallBuffer &walls)
+	{
+		float px = from.x;
+		float py = from.y;
+		float rx = to.x - from.x;
+		float ry = to.y - from.y;
+
+		int numWalls = walls.size();
+		const float *wx = walls.x.data();
+		const float *wy = walls.y.data();
+		const float *wdx = walls.dx.data();
+		const float *wdy = walls.dy.data();
+
+		// Branch-free blocks so the compiler can vectorize them, then one
+		// early-out test per block.
+		int i = 0;
+		for (; i + blockSize <= numWalls; i += blockSize)
+		{
+			int blocked = 0;
+			for (int k = i; k < i + blockSize; k++)
+			{
+				blocked |= blocks(px, py, rx, ry, wx[k], wy[k], wdx[k], wdy[k]);
+			}
+
+			if (blocked)
+			{
+				return false;
+			}
+		}
+
+		for (; i < numWalls; i++)
+		{
+			if (blocks(px, py, rx, ry, wx[i], wy[i], wdx[i], wdy[i]))
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	// Bit i of visibleMask is set when from[i] can see to[i].
+	static void query(const std::vector<Vector3D> &from, const std::vector<Vector3D> &to, const WallBuffer &walls, std::vector<unsigned int> &visibleMask, int numThreads = 0)
+	{
+		int numPairs = (int)std::min(from.size(), to.size());
+		int numWords = (numPairs + 31) / 32;
+		visibleMask.assign(numWords, 0);
+
+		if (numThreads <= 0)
+		{
+			numThreads = std::max(1, (int)std::thread::hardware_concurrency());
+		}
+		numThreads = std::max(1, std::min(numThreads, numWords));
+
+		// Threads own whole mask words, so no two of them write the same word
+		int wordsPerThread = (numWords + numThreads - 1) / numThreads;
+
+		auto worker = [&](int firstWord, int lastWord)
+		{
+			for (int w = firstWord; w < lastWord; w++)
+			{
+				unsigned int bits = 0;
+				int end = std::min(numPairs, (w + 1) * 32);
+				for (int i = w * 32; i < end; i++)
+				{
+					if (isVisible(from[i], to[i], walls))
+					{
+						bits |= 1u << (i - w * 32);
+					}
+				}
+				visibleMask[w] = bits;
+			}
+		};
+
+		std::vector<std::thread> threads;
+		for (int t = 1; t < numThreads; t++)
+		{
+			int firstWord = t * wordsPerThread;
+			int lastWord = std::min(numWords, firstWord + wordsPerThread);
+			if (firstWord < lastWord)
+			{
+				threads.push_back(std::thread(worker, firstWord, lastWord));
+			}
+		}
+
+		worker(0, std::min(numWords, wordsPerThread));
+
+		for (int t = 0; t < threads.size(); t++)
+		{
+			threads[t].join();
+		}
+	}
+
+	static bool isPairVisible(const std::vector<unsigned int> &visibleMask, int pair)
+	{
+		return (visibleMask[pair / 32] >> (pair % 32)) & 1u;
+	}
+private:
+	// No back-face culling here: a segment is blocked the same way from either
+	// end, and one-sided walls still block segments that leave a solid
+	static int blocks(float px, float py, float rx, float ry, float qx, float qy, float sx, float sy)
+	{
+		float denom = rx * sy - ry * sx;
+		float ox = qx - px;
+		float oy = qy - py;
+		float t = (ox * sy - oy * sx) / denom;
+		float u = (ox * ry - oy * rx) / denom;
+
+		// Parallel walls give inf/nan and fail every comparison
+		return (t > 0.0f) & (t < 1.0f) & (u >= 0.0f) & (u <= 1.0f);
+	}
+};
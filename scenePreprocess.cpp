@@ -0,0 +1,255 @@
+#pragma once
+#include "pch.h"
+#include "rayTracer.cpp"
+
+struct PreprocessStats
+{
+	int inputWalls;
+	int weldedEndpoints;
+	int droppedWalls;
+	int mergedWalls;
+	int outputWalls;
+};
+
+// Cleans an authored or imported wall list before it is indexed: welds
+// endpoints closer than weldDistance, drops walls that collapse to a point
+// or repeat another wall, merges collinear walls that meet end to end at a
+// vertex nothing else touches, then sorts the survivors along a Hilbert
+// curve so walls that are near in space are near in memory.
+class ScenePreprocessor
+{
+public:
+	ScenePreprocessor() : weldDistance(1e-3f), collinearTolerance(1e-4f) {};
+
+	PreprocessStats process(std::vector<Line> &walls)
+	{
+		PreprocessStats stats{ (int)walls.size(), 0, 0, 0, 0 };
+
+		weld(walls, stats);
+		merge(walls, stats);
+		reorder(walls);
+
+		stats.outputWalls = (int)walls.size();
+		return stats;
+	}
+public:
+	float weldDistance;
+	float collinearTolerance;
+private:
+	void weld(std::vector<Line> &walls, PreprocessStats &stats)
+	{
+		m_vertices.clear();
+		m_wallVertices.clear();
+		m_wallOneSided.clear();
+
+		std::unordered_map<unsigned long long, std::vector<int>> cells;
+		float cellSize = std::max(weldDistance, 1e-6f);
+
+		auto findOrAdd = [&](const Vector3D &p)
+		{
+			long long cx = (long long)floor(p.x / cellSize);
+			long long cy = (long long)floor(p.y / cellSize);
+
+			for (long long y = cy - 1; y <= cy + 1; y++)
+			{
+				for (long long x = cx - 1; x <= cx + 1; x++)
+				{
+					auto it = cells.find(cellKey(x, y));
+					if (it == cells.end())
+					{
+						continue;
+					}
+
+					for (int i = 0; i < it->second.size(); i++)
+					{
+						const Vector3D &v = m_vertices[it->second[i]];
+						float dx = v.x - p.x;
+						float dy = v.y - p.y;
+						if (dx * dx + dy * dy <= weldDistance * weldDistance)
+						{
+							if (v.x != p.x || v.y != p.y)
+							{
+								stats.weldedEndpoints++;
+							}
+							return it->second[i];
+						}
+					}
+				}
+			}
+
+			m_vertices.push_back(Vector3D(p.x, p.y, 0.0f));
+			cells[cellKey(cx, cy)].push_back((int)m_vertices.size() - 1);
+			return (int)m_vertices.size() - 1;
+		};
+
+		std::unordered_map<unsigned long long, int> seen;
+		for (int i = 0; i < walls.size(); i++)
+		{
+			int a = findOrAdd(walls[i].m_p1);
+			int b = findOrAdd(walls[i].m_p2);
+
+			if (a == b)
+			{
+				stats.droppedWalls++;
+				continue;
+			}
+
+			// One-sided walls only repeat when they also face the same way
+			bool oneSided = walls[i].m_oneSided;
+			unsigned long long first = oneSided ? a : std::min(a, b);
+			unsigned long long second = oneSided ? b : std::max(a, b);
+			unsigned long long key = (first << 32) | (second << 1) | oneSided;
+			if (!seen.insert(std::make_pair(key, i)).second)
+			{
+				stats.droppedWalls++;
+				continue;
+			}
+
+			m_wallVertices.push_back(std::make_pair(a, b));
+			m_wallOneSided.push_back(oneSided);
+		}
+	}
+
+	void merge(std::vector<Line> &walls, PreprocessStats &stats)
+	{
+		std::vector<std::vector<int>> incident(m_vertices.size());
+		for (int i = 0; i < m_wallVertices.size(); i++)
+		{
+			incident[m_wallVertices[i].first].push_back(i);
+			incident[m_wallVertices[i].second].push_back(i);
+		}
+
+		std::vector<bool> removed(m_wallVertices.size(), false);
+		for (int v = 0; v < m_vertices.size(); v++)
+		{
+			if (incident[v].size() != 2)
+			{
+				continue;
+			}
+
+			int a = incident[v][0];
+			int b = incident[v][1];
+			int farA = other(m_wallVertices[a], v);
+			int farB = other(m_wallVertices[b], v);
+
+			Vector3D da = m_vertices[farA] - m_vertices[v];
+			Vector3D db = m_vertices[farB] - m_vertices[v];
+			float lengths = da.magnitude() * db.magnitude();
+			float cross = da.x * db.y - da.y * db.x;
+
+			// Collinear and on opposite sides of v
+			if (farA == farB || fabs(cross) > collinearTolerance * lengths || da.dotProduct(db) >= 0.0f)
+			{
+				continue;
+			}
+
+			// One-sided walls merge only with one running the same way
+			bool continues = m_wallVertices[a].second == v ? m_wallVertices[b].first == v : m_wallVertices[b].second == v;
+			if (m_wallOneSided[a] != m_wallOneSided[b] || (m_wallOneSided[a] && !continues))
+			{
+				continue;
+			}
+
+			// a keeps its direction and takes over b's far end
+			if (m_wallVertices[a].first == v)
+			{
+				m_wallVertices[a].first = farB;
+			}
+			else
+			{
+				m_wallVertices[a].second = farB;
+			}
+			removed[b] = true;
+			stats.mergedWalls++;
+
+			std::vector<int> &farIncident = incident[farB];
+			std::replace(farIncident.begin(), farIncident.end(), b, a);
+			incident[v].clear();
+		}
+
+		walls.clear();
+		for (int i = 0; i < m_wallVertices.size(); i++)
+		{
+			if (!removed[i])
+			{
+				walls.push_back(Line(m_vertices[m_wallVertices[i].first], m_vertices[m_wallVertices[i].second], m_wallOneSided[i]));
+			}
+		}
+	}
+
+	void reorder(std::vector<Line> &walls) const
+	{
+		if (walls.empty())
+		{
+			return;
+		}
+
+		float minX = INFINITY, minY = INFINITY, maxX = -INFINITY, maxY = -INFINITY;
+		for (int i = 0; i < walls.size(); i++)
+		{
+			Vector3D mid = (walls[i].m_p1 + walls[i].m_p2) * 0.5f;
+			minX = std::min(minX, mid.x);
+			minY = std::min(minY, mid.y);
+			maxX = std::max(maxX, mid.x);
+			maxY = std::max(maxY, mid.y);
+		}
+
+		float scale = 65535.0f / std::max(std::max(maxX - minX, maxY - minY), 1e-6f);
+
+		std::vector<std::pair<unsigned long long, int>> keys(walls.size());
+		for (int i = 0; i < walls.size(); i++)
+		{
+			Vector3D mid = (walls[i].m_p1 + walls[i].m_p2) * 0.5f;
+			unsigned int x = (unsigned int)((mid.x - minX) * scale);
+			unsigned int y = (unsigned int)((mid.y - minY) * scale);
+			keys[i] = std::make_pair(hilbert(x, y), i);
+		}
+		std::sort(keys.begin(), keys.end());
+
+		std::vector<Line> sorted;
+		sorted.reserve(walls.size());
+		for (int i = 0; i < keys.size(); i++)
+		{
+			sorted.push_back(walls[keys[i].second]);
+		}
+		walls.swap(sorted);
+	}
+
+	// Distance along a 2^16 x 2^16 Hilbert curve
+	static unsigned long long hilbert(unsigned int x, unsigned int y)
+	{
+		unsigned long long d = 0;
+		for (unsigned int s = 1u << 15; s > 0; s >>= 1)
+		{
+			unsigned int rx = (x & s) > 0;
+			unsigned int ry = (y & s) > 0;
+			d += (unsigned long long)s * s * ((3 * rx) ^ ry);
+
+			if (ry == 0)
+			{
+				if (rx == 1)
+				{
+					x = 0xffff - x;
+					y = 0xffff - y;
+				}
+				std::swap(x, y);
+			}
+		}
+
+		return d;
+	}
+
+	static int other(const std::pair<int, int> &wall, int v)
+	{
+		return wall.first == v ? wall.second : wall.first;
+	}
+
+	static unsigned long long cellKey(long long x, long long y)
+	{
+		return ((unsigned long long)(unsigned int)x << 32) | (unsigned int)y;
+	}
+private:
+	std::vector<Vector3D> m_vertices;
+	std::vector<std::pair<int, int>> m_wallVertices;
+	std::vector<bool> m_wallOneSided;
+};
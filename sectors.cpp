@@ -0,0 +1,236 @@
+#pragma once
+#include "pch.h"
+#include "occluders.cpp"
+
+struct SectorEdge
+{
+	Vector3D a;
+	Vector3D b;
+	int neighbour;
+};
+
+class Sector
+{
+public:
+	ConvexPolygon outline;
+	std::vector<SectorEdge> edges;
+	std::vector<int> walls;
+};
+
+// Convex rooms linked through shared edges (portals). A ray only tests the
+// walls of the sectors it actually passes through, so its cost depends on the
+// rooms around it and not on the size of the whole map. Rays that leave
+// through an edge with no neighbour fall back to testing every wall.
+class SectorMap
+{
+public:
+	SectorMap() : epsilon(1e-4f) {};
+
+	int addSector(const std::vector<Vector3D> &points)
+	{
+		Sector s;
+		s.outline = ConvexPolygon(points);
+
+		m_sectors.push_back(s);
+
+		return (int)m_sectors.size() - 1;
+	}
+
+	// Links sectors through edges they share and hands each wall to every
+	// sector it overlaps
+	void build(const std::vector<Line> &walls)
+	{
+		m_walls = walls;
+
+		for (int i = 0; i < m_sectors.size(); i++)
+		{
+			Sector &s = m_sectors[i];
+			const std::vector<Vector3D> &points = s.outline.points;
+
+			s.edges.clear();
+			s.walls.clear();
+			for (int j = 0; j < points.size(); j++)
+			{
+				s.edges.push_back(SectorEdge{ points[j], points[(j + 1) % points.size()], -1 });
+			}
+		}
+
+		for (int i = 0; i < m_sectors.size(); i++)
+		{
+			for (int j = i + 1; j < m_sectors.size(); j++)
+			{
+				linkPortals(i, j);
+			}
+		}
+
+		for (int w = 0; w < m_walls.size(); w++)
+		{
+			const Line &wall = m_walls[w];
+			for (int i = 0; i < m_sectors.size(); i++)
+			{
+				if (OccluderTraits<ConvexPolygon>::rayDistance(m_sectors[i].outline, wall.m_p1, wall.m_direction) <= 1.0f)
+				{
+					m_sectors[i].walls.push_back(w);
+				}
+			}
+		}
+	}
+
+	int findSector(const Vector3D &p) const
+	{
+		for (int i = 0; i < m_sectors.size(); i++)
+		{
+			if (OccluderTraits<ConvexPolygon>::rayDistance(m_sectors[i].outline, p, Vector3D(1.0f, 0.0f, 0.0f)) == 0.0f)
+			{
+				return i;
+			}
+		}
+
+		return -1;
+	}
+
+	// Distance to the first wall along a unit direction, INFINITY if none
+	float closestHit(const Vector3D &origin, const Vector3D &direction, float maxDistance, int &wall) const
+	{
+		wall = -1;
+
+		int sector = findSector(origin);
+		if (sector == -1)
+		{
+			return bruteForce(origin, direction, maxDistance, wall);
+		}
+
+		float bestDistance = INFINITY;
+		for (int step = 0; step <= m_sectors.size() && sector != -1; step++)
+		{
+			const Sector &s = m_sectors[sector];
+
+			for (int i = 0; i < s.walls.size(); i++)
+			{
+				float distance = OccluderTraits<Line>::rayDistance(m_walls[s.walls[i]], origin, direction);
+				if (distance < bestDistance)
+				{
+					bestDistance = distance;
+					wall = s.walls[i];
+				}
+			}
+
+			int exitEdge = -1;
+			float exitDistance = INFINITY;
+			for (int i = 0; i < s.edges.size(); i++)
+			{
+				const SectorEdge &e = s.edges[i];
+
+				float nx = e.b.y - e.a.y;
+				float ny = e.a.x - e.b.x;
+				float speed = nx * direction.x + ny * direction.y;
+				if (speed <= 0.0f)
+				{
+					continue;
+				}
+
+				float t = -(nx * (origin.x - e.a.x) + ny * (origin.y - e.a.y)) / speed;
+				if (t < exitDistance)
+				{
+					exitDistance = t;
+					exitEdge = i;
+				}
+			}
+
+			if (bestDistance <= exitDistance + epsilon || exitEdge == -1 || exitDistance > maxDistance)
+			{
+				break;
+			}
+
+			sector = s.edges[exitEdge].neighbour;
+			if (sector == -1)
+			{
+				// Left the sectored area through an open edge
+				int outsideWall;
+				float outsideDistance = bruteForce(origin, direction, maxDistance, outsideWall);
+				if (outsideDistance < bestDistance)
+				{
+					bestDistance = outsideDistance;
+					wall = outsideWall;
+				}
+			}
+		}
+
+		if (bestDistance > maxDistance)
+		{
+			wall = -1;
+			return INFINITY;
+		}
+
+		return bestDistance;
+	}
+
+	// Same contract as Circle::pointMinRayMagnitude, for fan rays
+	float rayMagnitude(const Line &ray) const
+	{
+		Vector3D direction = ray.m_direction;
+		float length = direction.magnitude();
+		direction *= 1.0f / length;
+
+		int wall;
+		return closestHit(ray.m_p1, direction, length, wall);
+	}
+
+	const std::vector<Sector> &sectors() const
+	{
+		return m_sectors;
+	}
+public:
+	float epsilon;
+private:
+	void linkPortals(int i, int j)
+	{
+		std::vector<SectorEdge> &edgesI = m_sectors[i].edges;
+		std::vector<SectorEdge> &edgesJ = m_sectors[j].edges;
+
+		for (int a = 0; a < edgesI.size(); a++)
+		{
+			for (int b = 0; b < edgesJ.size(); b++)
+			{
+				// Shared edges run in opposite directions in two CCW outlines
+				if (nearlyEqual(edgesI[a].a, edgesJ[b].b) && nearlyEqual(edgesI[a].b, edgesJ[b].a))
+				{
+					edgesI[a].neighbour = j;
+					edgesJ[b].neighbour = i;
+				}
+			}
+		}
+	}
+
+	bool nearlyEqual(const Vector3D &a, const Vector3D &b) const
+	{
+		return fabs(a.x - b.x) <= epsilon && fabs(a.y - b.y) <= epsilon;
+	}
+
+	float bruteForce(const Vector3D &origin, const Vector3D &direction, float maxDistance, int &wall) const
+	{
+		wall = -1;
+
+		float bestDistance = INFINITY;
+		for (int i = 0; i < m_walls.size(); i++)
+		{
+			float distance = OccluderTraits<Line>::rayDistance(m_walls[i], origin, direction);
+			if (distance < bestDistance)
+			{
+				bestDistance = distance;
+				wall = i;
+			}
+		}
+
+		if (bestDistance > maxDistance)
+		{
+			wall = -1;
+			return INFINITY;
+		}
+
+		return bestDistance;
+	}
+private:
+	std::vector<Sector> m_sectors;
+	std::vector<Line> m_walls;
+};
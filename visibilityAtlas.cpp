@@ -0,0 +1,309 @@
+#pragma once
+#include "pch.h"
+#include "occluders.cpp"
+
+// Everything one bake produces. Never changed once published, so queries can
+// keep using it while the next bake is built.
+struct AtlasBake
+{
+	AtlasBake() {};
+	AtlasBake(const AtlasBake &) = delete;
+	AtlasBake &operator=(const AtlasBake &) = delete;
+
+	OccluderScene scene;
+	OccluderGrid grid;
+	Vector3D min;
+	float spacing;
+	int numDirections;
+	float maxDistance;
+	int samplesX;
+	int samplesY;
+	bool baked;
+	std::vector<Vector3D> directions;
+	std::vector<unsigned short> distances;
+};
+
+// Hit distances baked for a grid of emitter positions over static walls.
+// Each sample stores one 16-bit quantized distance per fan direction. A query
+// blends the four surrounding samples when their hit points lie on one line,
+// which is when they hit the same wall and the distance is linear in the
+// position. Otherwise an occlusion edge passes between them and the
+// direction is retraced. Samples that hit different parts of one straight
+// line, across a gap in it, are still blended.
+class VisibilityAtlas
+{
+public:
+	VisibilityAtlas() : m_tolerance(0.05f) {};
+	VisibilityAtlas(const VisibilityAtlas &) = delete;
+	VisibilityAtlas &operator=(const VisibilityAtlas &) = delete;
+
+	~VisibilityAtlas()
+	{
+		if (m_bakeThread.joinable())
+		{
+			m_bakeThread.join();
+		}
+	}
+
+	void bake(const std::vector<Line> &walls, const Vector3D &min, const Vector3D &max, float spacing, int numDirections, float maxDistance = 1024.0f)
+	{
+		std::shared_ptr<AtlasBake> b = prepare(walls, min, max, spacing, numDirections, maxDistance);
+		b->distances.resize((size_t)b->samplesX * b->samplesY * numDirections);
+
+		int numThreads = std::max(1, (int)std::thread::hardware_concurrency());
+		std::vector<std::thread> threads;
+		for (int t = 0; t < numThreads; t++)
+		{
+			threads.push_back(std::thread([&b, t, numThreads]()
+			{
+				for (int y = t; y < b->samplesY; y += numThreads)
+				{
+					for (int x = 0; x < b->samplesX; x++)
+					{
+						bakeSample(*b, x, y);
+					}
+				}
+			}));
+		}
+
+		for (int t = 0; t < threads.size(); t++)
+		{
+			threads[t].join();
+		}
+
+		b->baked = true;
+		publish(b);
+	}
+
+	// Bakes on a background thread; until ready() queries trace against a
+	// copy of the walls made here, not the one being baked
+	void bakeAsync(const std::vector<Line> &walls, const Vector3D &min, const Vector3D &max, float spacing, int numDirections, float maxDistance = 1024.0f)
+	{
+		if (m_bakeThread.joinable())
+		{
+			m_bakeThread.join();
+		}
+
+		publish(prepare(walls, min, max, spacing, numDirections, maxDistance));
+
+		m_bakeThread = std::thread([this, walls, min, max, spacing, numDirections, maxDistance]()
+		{
+			bake(walls, min, max, spacing, numDirections, maxDistance);
+		});
+	}
+
+	bool ready() const
+	{
+		std::shared_ptr<const AtlasBake> b = current();
+		return b && b->baked;
+	}
+
+	// Distance from pos to the first wall along each baked direction
+	void query(const Vector3D &pos, std::vector<float> &distances) const
+	{
+		std::shared_ptr<const AtlasBake> b = current();
+		if (!b)
+		{
+			distances.clear();
+			return;
+		}
+
+		query(*b, pos, distances);
+	}
+
+	// Rebuilds the fan of c from the atlas instead of Circle::placePoints
+	void apply(Circle &c) const
+	{
+		c.circleLines.clear();
+
+		std::shared_ptr<const AtlasBake> b = current();
+		if (!b)
+		{
+			return;
+		}
+
+		std::vector<float> distances;
+		query(*b, c.pos, distances);
+
+		for (int k = 0; k < b->numDirections; k++)
+		{
+			Vector3D a = c.pos + b->directions[k] * c.r;
+			Vector3D end = c.pos + b->directions[k] * std::max(distances[k], c.r);
+
+			c.circleLines.push_back(Line(a, end));
+		}
+	}
+
+	int numDirections() const
+	{
+		std::shared_ptr<const AtlasBake> b = current();
+		return b ? b->numDirections : 0;
+	}
+
+	// Furthest a sample's hit point may be from the line through the others,
+	// in world units, before the direction is retraced
+	float tolerance() const
+	{
+		return m_tolerance;
+	}
+
+	void setTolerance(float tolerance)
+	{
+		m_tolerance = tolerance;
+	}
+private:
+	static std::shared_ptr<AtlasBake> prepare(const std::vector<Line> &walls, const Vector3D &min, const Vector3D &max, float spacing, int numDirections, float maxDistance)
+	{
+		std::shared_ptr<AtlasBake> b(new AtlasBake());
+
+		b->scene.lines = walls;
+		b->grid.build(b->scene);
+
+		b->min = min;
+		b->spacing = spacing;
+		b->numDirections = numDirections;
+		b->maxDistance = maxDistance;
+		b->samplesX = std::max(2, (int)ceil((max.x - min.x) / spacing) + 1);
+		b->samplesY = std::max(2, (int)ceil((max.y - min.y) / spacing) + 1);
+		b->baked = false;
+
+		b->directions.resize(numDirections);
+		for (int k = 0; k < numDirections; k++)
+		{
+			float theta = 2 * M_PI * k / (float)numDirections;
+			b->directions[k] = Vector3D(cos(theta), sin(theta), 0.0f);
+		}
+
+		return b;
+	}
+
+	void query(const AtlasBake &b, const Vector3D &pos, std::vector<float> &distances) const
+	{
+		distances.resize(b.numDirections);
+
+		float fx = (pos.x - b.min.x) / b.spacing;
+		float fy = (pos.y - b.min.y) / b.spacing;
+		int x = (int)floor(fx);
+		int y = (int)floor(fy);
+
+		if (!b.baked || x < 0 || y < 0 || x >= b.samplesX - 1 || y >= b.samplesY - 1)
+		{
+			for (int k = 0; k < b.numDirections; k++)
+			{
+				distances[k] = trace(b, pos, k);
+			}
+			return;
+		}
+
+		float wx = fx - x;
+		float wy = fy - y;
+		const unsigned short *d00 = sample(b, x, y);
+		const unsigned short *d10 = sample(b, x + 1, y);
+		const unsigned short *d01 = sample(b, x, y + 1);
+		const unsigned short *d11 = sample(b, x + 1, y + 1);
+
+		Vector3D p00(b.min.x + x * b.spacing, b.min.y + y * b.spacing, 0.0f);
+		Vector3D p10 = p00 + Vector3D(b.spacing, 0.0f, 0.0f);
+		Vector3D p01 = p00 + Vector3D(0.0f, b.spacing, 0.0f);
+		Vector3D p11 = p00 + Vector3D(b.spacing, b.spacing, 0.0f);
+
+		for (int k = 0; k < b.numDirections; k++)
+		{
+			// Nothing hit from any of the four
+			if ((d00[k] & d10[k] & d01[k] & d11[k]) == 65535)
+			{
+				distances[k] = b.maxDistance;
+				continue;
+			}
+
+			const Vector3D &direction = b.directions[k];
+			Vector3D h00 = p00 + direction * decode(b, d00[k]);
+			Vector3D h10 = p10 + direction * decode(b, d10[k]);
+			Vector3D h01 = p01 + direction * decode(b, d01[k]);
+			Vector3D h11 = p11 + direction * decode(b, d11[k]);
+
+			if (!onOneLine(h00, h11, h10, h01))
+			{
+				distances[k] = trace(b, pos, k);
+				continue;
+			}
+
+			float top = decode(b, d00[k]) * (1.0f - wx) + decode(b, d10[k]) * wx;
+			float bottom = decode(b, d01[k]) * (1.0f - wx) + decode(b, d11[k]) * wx;
+			distances[k] = top * (1.0f - wy) + bottom * wy;
+		}
+	}
+
+	// Measured from the longer diagonal, the other two points within tolerance
+	bool onOneLine(const Vector3D &a0, const Vector3D &a1, const Vector3D &b0, const Vector3D &b1) const
+	{
+		Vector3D da = a1 - a0;
+		Vector3D db = b1 - b0;
+		float lengthA = da.dotProduct(da);
+		float lengthB = db.dotProduct(db);
+
+		const Vector3D &origin = lengthA >= lengthB ? a0 : b0;
+		const Vector3D &d = lengthA >= lengthB ? da : db;
+		const Vector3D &q0 = lengthA >= lengthB ? b0 : a0;
+		const Vector3D &q1 = lengthA >= lengthB ? b1 : a1;
+		float length = sqrt(std::max(lengthA, lengthB));
+
+		if (length <= m_tolerance)
+		{
+			return true;
+		}
+
+		float e0 = fabs(d.x * (q0.y - origin.y) - d.y * (q0.x - origin.x)) / length;
+		float e1 = fabs(d.x * (q1.y - origin.y) - d.y * (q1.x - origin.x)) / length;
+
+		return e0 <= m_tolerance && e1 <= m_tolerance;
+	}
+
+	static void bakeSample(AtlasBake &b, int x, int y)
+	{
+		Vector3D pos(b.min.x + x * b.spacing, b.min.y + y * b.spacing, 0.0f);
+		unsigned short *distances = &b.distances[((size_t)y * b.samplesX + x) * b.numDirections];
+
+		for (int k = 0; k < b.numDirections; k++)
+		{
+			distances[k] = encode(b, trace(b, pos, k));
+		}
+	}
+
+	static float trace(const AtlasBake &b, const Vector3D &pos, int k)
+	{
+		return std::min(b.grid.closestHit(pos, b.directions[k], b.maxDistance).distance, b.maxDistance);
+	}
+
+	static const unsigned short *sample(const AtlasBake &b, int x, int y)
+	{
+		return &b.distances[((size_t)y * b.samplesX + x) * b.numDirections];
+	}
+
+	static unsigned short encode(const AtlasBake &b, float distance)
+	{
+		return (unsigned short)(std::min(distance, b.maxDistance) / b.maxDistance * 65535.0f + 0.5f);
+	}
+
+	static float decode(const AtlasBake &b, unsigned short distance)
+	{
+		return distance * (b.maxDistance / 65535.0f);
+	}
+
+	std::shared_ptr<const AtlasBake> current() const
+	{
+		std::lock_guard<std::mutex> lock(m_currentMutex);
+		return m_current;
+	}
+
+	void publish(const std::shared_ptr<const AtlasBake> &b)
+	{
+		std::lock_guard<std::mutex> lock(m_currentMutex);
+		m_current = b;
+	}
+private:
+	float m_tolerance;
+	mutable std::mutex m_currentMutex;
+	std::shared_ptr<const AtlasBake> m_current;
+	std::thread m_bakeThread;
+};
@@ -0,0 +1,69 @@
+//
+// visibilityServer.cpp
+// Standalone visibility daemon for Linux game servers:
+//
+//   g++ -std=c++17 -O2 -pthread visibilityServer.cpp -o visibilityServer -lrt
+//   visibilityServer scene.txt [name] [slots]
+//
+// Loads the scene (one "x1 y1 x2 y2" wall per line), keeps it indexed and
+// serves VisibilityClient queries until SIGINT or SIGTERM.
+//
+
+#include "pch.h"
+#include "visibilityService.cpp"
+
+#ifndef _WIN32
+#include <cstdio>
+
+namespace
+{
+	volatile sig_atomic_t stopRequested = 0;
+
+	void onStopSignal(int)
+	{
+		stopRequested = 1;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 2)
+	{
+		fprintf(stderr, "usage: %s scene.txt [name] [slots]\n", argv[0]);
+		return 2;
+	}
+
+	std::string name = argc > 2 ? argv[2] : "default";
+	unsigned int numSlots = argc > 3 ? (unsigned int)atoi(argv[3]) : 8;
+
+	signal(SIGINT, onStopSignal);
+	signal(SIGTERM, onStopSignal);
+	signal(SIGPIPE, SIG_IGN);
+
+	try
+	{
+		std::vector<Line> walls;
+		loadWalls(argv[1], walls);
+
+		VisibilityServer server;
+		server.load(walls);
+		server.start(name, numSlots);
+
+		fprintf(stderr, "serving %zu walls as %s (%s, %s)\n", walls.size(), name.c_str(), visibilityShmName(name).c_str(), visibilitySocketPath(name).c_str());
+
+		while (!stopRequested)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		}
+
+		server.stop();
+	}
+	catch (const std::exception &e)
+	{
+		fprintf(stderr, "%s\n", e.what());
+		return 1;
+	}
+
+	return 0;
+}
+#endif
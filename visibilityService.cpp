@@ -0,0 +1,914 @@
+#pragma once
+#include "pch.h"
+
+// Linux only: the visibility daemon and its client. The map is loaded and
+// indexed once by the server; clients talk to it through a shared-memory
+// segment, or through a Unix socket when the segment is not reachable.
+#ifndef _WIN32
+#include "occluders.cpp"
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+enum class QueryType : unsigned int
+{
+	Emitter = 1,
+	LineOfSight = 2
+};
+
+// Emitter: count rays fanned evenly from (x, y), output is count float hit
+// distances. LineOfSight: input is count (from.x, from.y, to.x, to.y)
+// float quads, output is one visibility bit per pair in 32-bit words.
+// generation is the claim of the shared slot the request was sent on.
+struct QueryRequest
+{
+	unsigned int id;
+	unsigned int generation;
+	QueryType type;
+	unsigned int count;
+	float x;
+	float y;
+	float maxDistance;
+	unsigned long long inputOffset;
+	unsigned long long outputOffset;
+};
+
+struct QueryCompletion
+{
+	unsigned int id;
+	unsigned int generation;
+	int status;
+	unsigned int count;
+};
+
+// Single-producer single-consumer ring living in shared memory
+template<typename T, unsigned int N>
+struct SpscRing
+{
+	static_assert((N & (N - 1)) == 0, "SpscRing size must be a power of two");
+	static_assert(std::atomic<unsigned int>::is_always_lock_free, "SpscRing needs address-free atomics");
+
+	std::atomic<unsigned int> head;
+	std::atomic<unsigned int> tail;
+	T entries[N];
+
+	void reset()
+	{
+		head.store(0);
+		tail.store(0);
+	}
+
+	bool push(const T &entry)
+	{
+		unsigned int t = tail.load(std::memory_order_relaxed);
+		if (t - head.load(std::memory_order_acquire) == N)
+		{
+			return false;
+		}
+
+		entries[t & (N - 1)] = entry;
+		tail.store(t + 1, std::memory_order_release);
+
+		return true;
+	}
+
+	bool pop(T &entry)
+	{
+		unsigned int h = head.load(std::memory_order_relaxed);
+		if (h == tail.load(std::memory_order_acquire))
+		{
+			return false;
+		}
+
+		entry = entries[h & (N - 1)];
+		head.store(h + 1, std::memory_order_release);
+
+		return true;
+	}
+};
+
+const unsigned int visibilityServiceMagic = 0x52433244;
+const unsigned int visibilityServiceVersion = 3;
+const unsigned int visibilityRingSize = 64;
+// Rays or pairs per request, over either transport
+const unsigned int visibilityMaxCount = 1 << 20;
+// Rays or pairs the server handles between progress updates; whole mask words
+const unsigned int visibilityProgressChunk = 1 << 14;
+
+// Every claim of a slot starts a new generation. The server acknowledges it
+// once nothing an earlier owner queued is still waiting or running, and the
+// new owner uses the slot only after that.
+struct SharedSlot
+{
+	std::atomic<int> owner;
+	std::atomic<unsigned int> generation;
+	std::atomic<unsigned int> acknowledged;
+	// Bumped by the server as it works through requests, so a client can
+	// tell a long query from a stuck server
+	std::atomic<unsigned int> progress;
+	SpscRing<QueryRequest, visibilityRingSize> submissions;
+	SpscRing<QueryCompletion, visibilityRingSize> completions;
+};
+
+struct SharedHeader
+{
+	unsigned int magic;
+	unsigned int version;
+	unsigned int numSlots;
+	// A server killed outright leaves the segment behind, so clients check
+	// this process is still alive
+	int serverPid;
+	unsigned long long arenaSize;
+	unsigned long long slotsOffset;
+	unsigned long long arenasOffset;
+};
+
+inline bool isProcessAlive(int pid)
+{
+	return pid > 0 && !(kill(pid, 0) == -1 && errno == ESRCH);
+}
+
+inline std::string visibilityShmName(const std::string &name)
+{
+	return "/raycast2d-" + name;
+}
+
+inline std::string visibilitySocketPath(const std::string &name)
+{
+	return "/tmp/raycast2d-" + name + ".sock";
+}
+
+// One wall per line: x1 y1 x2 y2
+inline void loadWalls(const std::string &path, std::vector<Line> &walls)
+{
+	std::ifstream file(path);
+	if (!file)
+	{
+		throw std::runtime_error("Cannot open scene " + path);
+	}
+
+	float x1, y1, x2, y2;
+	while (file >> x1 >> y1 >> x2 >> y2)
+	{
+		walls.push_back(Line(Vector3D(x1, y1, 0.0f), Vector3D(x2, y2, 0.0f)));
+	}
+}
+
+inline bool readFully(int fd, void *data, size_t size)
+{
+	char *p = (char *)data;
+	while (size > 0)
+	{
+		ssize_t n = read(fd, p, size);
+		if (n <= 0)
+		{
+			if (n < 0 && errno == EINTR)
+			{
+				continue;
+			}
+			return false;
+		}
+		p += n;
+		size -= n;
+	}
+
+	return true;
+}
+
+inline bool writeFully(int fd, const void *data, size_t size)
+{
+	const char *p = (const char *)data;
+	while (size > 0)
+	{
+		// A peer that went away is an error, not SIGPIPE
+		ssize_t n = send(fd, p, size, MSG_NOSIGNAL);
+		if (n <= 0)
+		{
+			if (n < 0 && errno == EINTR)
+			{
+				continue;
+			}
+			return false;
+		}
+		p += n;
+		size -= n;
+	}
+
+	return true;
+}
+
+inline size_t queryInputSize(const QueryRequest &request)
+{
+	return request.type == QueryType::LineOfSight ? (size_t)request.count * 4 * sizeof(float) : 0;
+}
+
+inline size_t queryOutputSize(const QueryRequest &request)
+{
+	return request.type == QueryType::LineOfSight ? (size_t)(request.count + 31) / 32 * sizeof(unsigned int) : (size_t)request.count * sizeof(float);
+}
+
+// Checked before anything is sized from a request a client sent
+inline bool isValidQuery(const QueryRequest &request)
+{
+	return (request.type == QueryType::Emitter || request.type == QueryType::LineOfSight) && request.count <= visibilityMaxCount;
+}
+
+// A socket connection and the thread serving it; the server closes fd only
+// after joining the thread
+struct SocketClient
+{
+	int fd;
+	std::atomic<bool> done;
+	std::thread thread;
+};
+
+class VisibilityServer
+{
+public:
+	VisibilityServer() : m_header(nullptr), m_mappedSize(0), m_socket(-1), m_running(false) {};
+	VisibilityServer(const VisibilityServer &) = delete;
+	VisibilityServer &operator=(const VisibilityServer &) = delete;
+
+	~VisibilityServer()
+	{
+		stop();
+	}
+
+	void load(const std::vector<Line> &walls)
+	{
+		m_scene.lines = walls;
+		m_grid.build(m_scene);
+		m_wallBuffer.build(walls);
+	}
+
+	void start(const std::string &name, unsigned int numSlots = 8, unsigned long long arenaSize = 4 << 20)
+	{
+		m_name = name;
+		m_running = true;
+
+		createSharedMemory(numSlots, arenaSize);
+		createSocket();
+
+		for (unsigned int i = 0; i < numSlots; i++)
+		{
+			m_slotThreads.push_back(std::thread([this, i]() { pollSlot(i); }));
+		}
+		m_acceptThread = std::thread([this]() { acceptSockets(); });
+	}
+
+	void stop()
+	{
+		if (!m_running)
+		{
+			return;
+		}
+		m_running = false;
+
+		shutdown(m_socket, SHUT_RDWR);
+		close(m_socket);
+		for (int i = 0; i < m_slotThreads.size(); i++)
+		{
+			m_slotThreads[i].join();
+		}
+		m_slotThreads.clear();
+		m_acceptThread.join();
+
+		// Wake clients blocked in read and wait for them, since they run
+		// queries against the scene
+		{
+			std::lock_guard<std::mutex> lock(m_clientsMutex);
+			for (int i = 0; i < m_clients.size(); i++)
+			{
+				shutdown(m_clients[i]->fd, SHUT_RDWR);
+			}
+			for (int i = 0; i < m_clients.size(); i++)
+			{
+				m_clients[i]->thread.join();
+				close(m_clients[i]->fd);
+			}
+			m_clients.clear();
+		}
+
+		munmap(m_header, m_mappedSize);
+		shm_unlink(visibilityShmName(m_name).c_str());
+		unlink(visibilitySocketPath(m_name).c_str());
+	}
+
+	// Fills output (queryOutputSize bytes) for one request, bumping progress
+	// after every visibilityProgressChunk rays or pairs
+	int execute(const QueryRequest &request, const void *input, void *output, std::atomic<unsigned int> *progress = nullptr) const
+	{
+		if (request.type == QueryType::Emitter)
+		{
+			Vector3D origin(request.x, request.y, 0.0f);
+			float *distances = (float *)output;
+			for (unsigned int i = 0; i < request.count; i++)
+			{
+				float theta = 2 * M_PI * i / (float)request.count;
+				distances[i] = m_grid.closestHit(origin, Vector3D(cos(theta), sin(theta), 0.0f), request.maxDistance).distance;
+
+				if (progress && (i + 1) % visibilityProgressChunk == 0)
+				{
+					progress->fetch_add(1, std::memory_order_relaxed);
+				}
+			}
+
+			return 0;
+		}
+		else if (request.type == QueryType::LineOfSight)
+		{
+			const float *pairs = (const float *)input;
+			unsigned int *words = (unsigned int *)output;
+			std::vector<Vector3D> from;
+			std::vector<Vector3D> to;
+			std::vector<unsigned int> mask;
+
+			for (unsigned int first = 0; first < request.count; first += visibilityProgressChunk)
+			{
+				unsigned int count = std::min(visibilityProgressChunk, request.count - first);
+
+				from.resize(count);
+				to.resize(count);
+				for (unsigned int i = 0; i < count; i++)
+				{
+					const float *pair = pairs + (size_t)(first + i) * 4;
+					from[i] = Vector3D(pair[0], pair[1], 0.0f);
+					to[i] = Vector3D(pair[2], pair[3], 0.0f);
+				}
+
+				LineOfSight::query(from, to, m_wallBuffer, mask);
+				memcpy(words + first / 32, mask.data(), mask.size() * sizeof(unsigned int));
+
+				if (progress)
+				{
+					progress->fetch_add(1, std::memory_order_relaxed);
+				}
+			}
+
+			return 0;
+		}
+
+		return EINVAL;
+	}
+private:
+	void createSharedMemory(unsigned int numSlots, unsigned long long arenaSize)
+	{
+		std::string shmName = visibilityShmName(m_name);
+		shm_unlink(shmName.c_str());
+
+		int fd = shm_open(shmName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0660);
+		if (fd == -1)
+		{
+			throw std::runtime_error("shm_open failed for " + shmName);
+		}
+
+		unsigned long long slotsOffset = (sizeof(SharedHeader) + 63) & ~63ull;
+		unsigned long long arenasOffset = (slotsOffset + numSlots * sizeof(SharedSlot) + 4095) & ~4095ull;
+		m_mappedSize = arenasOffset + numSlots * arenaSize;
+
+		if (ftruncate(fd, m_mappedSize) == -1)
+		{
+			close(fd);
+			throw std::runtime_error("ftruncate failed for " + shmName);
+		}
+
+		void *memory = mmap(nullptr, m_mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		close(fd);
+		if (memory == MAP_FAILED)
+		{
+			throw std::runtime_error("mmap failed for " + shmName);
+		}
+
+		m_header = (SharedHeader *)memory;
+		m_header->numSlots = numSlots;
+		m_header->serverPid = (int)getpid();
+		m_header->arenaSize = arenaSize;
+		m_header->slotsOffset = slotsOffset;
+		m_header->arenasOffset = arenasOffset;
+		m_header->version = visibilityServiceVersion;
+
+		for (unsigned int i = 0; i < numSlots; i++)
+		{
+			SharedSlot &s = slot(i);
+			s.owner.store(0);
+			s.generation.store(0);
+			s.acknowledged.store(0);
+			s.progress.store(0);
+			s.submissions.reset();
+			s.completions.reset();
+		}
+
+		// Clients only attach once the magic is visible
+		std::atomic_thread_fence(std::memory_order_release);
+		m_header->magic = visibilityServiceMagic;
+	}
+
+	void createSocket()
+	{
+		std::string path = visibilitySocketPath(m_name);
+		unlink(path.c_str());
+
+		m_socket = socket(AF_UNIX, SOCK_STREAM, 0);
+
+		sockaddr_un address{};
+		address.sun_family = AF_UNIX;
+		strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+		if (m_socket == -1 || bind(m_socket, (sockaddr *)&address, sizeof(address)) == -1 || listen(m_socket, 16) == -1)
+		{
+			throw std::runtime_error("Cannot listen on " + path);
+		}
+	}
+
+	SharedSlot &slot(unsigned int i) const
+	{
+		return ((SharedSlot *)((char *)m_header + m_header->slotsOffset))[i];
+	}
+
+	char *arena(unsigned int i) const
+	{
+		return (char *)m_header + m_header->arenasOffset + i * m_header->arenaSize;
+	}
+
+	// One worker per slot, so a long query only holds up its own client
+	void pollSlot(unsigned int i)
+	{
+		SharedSlot &s = slot(i);
+
+		int idleRounds = 0;
+		while (m_running)
+		{
+			// Whatever is still queued belongs to earlier owners
+			unsigned int generation = s.generation.load(std::memory_order_acquire);
+			if (s.acknowledged.load(std::memory_order_relaxed) != generation)
+			{
+				QueryRequest stale;
+				while (s.submissions.pop(stale))
+				{
+				}
+				s.acknowledged.store(generation, std::memory_order_release);
+			}
+
+			bool worked = false;
+			QueryRequest request;
+			while (s.submissions.pop(request))
+			{
+				s.progress.fetch_add(1, std::memory_order_relaxed);
+				if (request.generation != generation)
+				{
+					continue;
+				}
+
+				QueryCompletion completion{ request.id, request.generation, 0, request.count };
+
+				if (!isValidQuery(request))
+				{
+					completion.status = EINVAL;
+				}
+				else if (!fitsArena(request.inputOffset, queryInputSize(request)) || !fitsArena(request.outputOffset, queryOutputSize(request)))
+				{
+					completion.status = ERANGE;
+				}
+				else
+				{
+					try
+					{
+						completion.status = execute(request, arena(i) + request.inputOffset, arena(i) + request.outputOffset, &s.progress);
+					}
+					catch (const std::exception &)
+					{
+						completion.status = ENOMEM;
+					}
+				}
+
+				// Dropped once the slot has changed hands
+				while (!s.completions.push(completion) && m_running && s.generation.load() == generation)
+				{
+					std::this_thread::yield();
+				}
+				worked = true;
+			}
+
+			// Spin while busy, back off to short sleeps when idle
+			idleRounds = worked ? 0 : idleRounds + 1;
+			if (idleRounds > 1000)
+			{
+				std::this_thread::sleep_for(std::chrono::microseconds(50));
+			}
+			else if (idleRounds > 0)
+			{
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	void acceptSockets()
+	{
+		while (m_running)
+		{
+			int client = accept(m_socket, nullptr, nullptr);
+			if (client == -1)
+			{
+				continue;
+			}
+
+			std::lock_guard<std::mutex> lock(m_clientsMutex);
+			if (!m_running)
+			{
+				close(client);
+				break;
+			}
+
+			// Collect the connections that have finished
+			for (int i = (int)m_clients.size() - 1; i >= 0; i--)
+			{
+				if (m_clients[i]->done)
+				{
+					m_clients[i]->thread.join();
+					close(m_clients[i]->fd);
+					m_clients.erase(m_clients.begin() + i);
+				}
+			}
+
+			std::unique_ptr<SocketClient> socketClient(new SocketClient());
+			socketClient->fd = client;
+			socketClient->done = false;
+
+			SocketClient *c = socketClient.get();
+			c->thread = std::thread([this, c]()
+			{
+				serveSocket(c->fd);
+				c->done = true;
+			});
+			m_clients.push_back(std::move(socketClient));
+		}
+	}
+
+	bool fitsArena(unsigned long long offset, size_t size) const
+	{
+		return offset <= m_header->arenaSize && size <= m_header->arenaSize - offset;
+	}
+
+	void serveSocket(int client) const
+	{
+		// Runs on its own thread, so nothing may escape it
+		try
+		{
+			std::vector<char> input;
+			std::vector<char> output;
+
+			QueryRequest request;
+			while (readFully(client, &request, sizeof(request)))
+			{
+				// The input of a bad request cannot be skipped, so answer and
+				// drop the connection
+				if (!isValidQuery(request))
+				{
+					QueryCompletion completion{ request.id, request.generation, EINVAL, 0 };
+					writeFully(client, &completion, sizeof(completion));
+					break;
+				}
+
+				input.resize(queryInputSize(request));
+				output.resize(queryOutputSize(request));
+				if (!readFully(client, input.data(), input.size()))
+				{
+					break;
+				}
+
+				QueryCompletion completion{ request.id, request.generation, execute(request, input.data(), output.data()), request.count };
+				if (!writeFully(client, &completion, sizeof(completion)) || !writeFully(client, output.data(), output.size()))
+				{
+					break;
+				}
+			}
+		}
+		catch (const std::exception &)
+		{
+		}
+	}
+private:
+	OccluderScene m_scene;
+	OccluderGrid m_grid;
+	WallBuffer m_wallBuffer;
+	std::string m_name;
+	SharedHeader *m_header;
+	size_t m_mappedSize;
+	int m_socket;
+	std::atomic<bool> m_running;
+	std::vector<std::thread> m_slotThreads;
+	std::thread m_acceptThread;
+	std::mutex m_clientsMutex;
+	std::vector<std::unique_ptr<SocketClient>> m_clients;
+};
+
+class VisibilityClient
+{
+public:
+	VisibilityClient() : timeoutMilliseconds(5000), m_header(nullptr), m_mappedSize(0), m_slot(-1), m_socket(-1), m_generation(0), m_nextId(1) {};
+	VisibilityClient(const VisibilityClient &) = delete;
+	VisibilityClient &operator=(const VisibilityClient &) = delete;
+
+	~VisibilityClient()
+	{
+		disconnect();
+	}
+
+	// Shared memory first, the Unix socket when no slot can be claimed
+	bool connect(const std::string &name)
+	{
+		disconnect();
+
+		if (attachSharedMemory(name))
+		{
+			return true;
+		}
+
+		std::string path = visibilitySocketPath(name);
+		m_socket = socket(AF_UNIX, SOCK_STREAM, 0);
+
+		sockaddr_un address{};
+		address.sun_family = AF_UNIX;
+		strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+		if (m_socket == -1 || ::connect(m_socket, (sockaddr *)&address, sizeof(address)) == -1)
+		{
+			disconnect();
+			return false;
+		}
+
+		return true;
+	}
+
+	void disconnect()
+	{
+		if (m_header)
+		{
+			slot().owner.store(0);
+			munmap(m_header, m_mappedSize);
+			m_header = nullptr;
+			m_slot = -1;
+		}
+
+		if (m_socket != -1)
+		{
+			close(m_socket);
+			m_socket = -1;
+		}
+	}
+
+	bool usesSharedMemory() const
+	{
+		return m_header != nullptr;
+	}
+
+	bool traceEmitter(const Vector3D &pos, unsigned int numRays, float maxDistance, std::vector<float> &distances)
+	{
+		QueryRequest request{ 0, 0, QueryType::Emitter, numRays, pos.x, pos.y, maxDistance, 0, 0 };
+		if (!isValidQuery(request))
+		{
+			return false;
+		}
+		distances.resize(numRays);
+
+		return run(request, nullptr, distances.data());
+	}
+
+	// Bit i of visibleMask is set when from[i] can see to[i]; large batches
+	// are split to fit the shared arena
+	bool lineOfSight(const std::vector<Vector3D> &from, const std::vector<Vector3D> &to, std::vector<unsigned int> &visibleMask)
+	{
+		unsigned int numPairs = (unsigned int)std::min(from.size(), to.size());
+		visibleMask.assign((numPairs + 31) / 32, 0);
+
+		// Whole words per chunk so the masks concatenate
+		unsigned int chunk = visibilityMaxCount;
+		if (m_header)
+		{
+			unsigned long long perPair = 4 * sizeof(float) + 1;
+			chunk = std::min(chunk, std::max(32u, (unsigned int)(m_header->arenaSize / perPair) / 32 * 32));
+		}
+
+		std::vector<float> pairs;
+		for (unsigned int first = 0; first < numPairs; first += chunk)
+		{
+			unsigned int count = std::min(chunk, numPairs - first);
+
+			pairs.resize(count * 4);
+			for (unsigned int i = 0; i < count; i++)
+			{
+				pairs[i * 4 + 0] = from[first + i].x;
+				pairs[i * 4 + 1] = from[first + i].y;
+				pairs[i * 4 + 2] = to[first + i].x;
+				pairs[i * 4 + 3] = to[first + i].y;
+			}
+
+			QueryRequest request{ 0, 0, QueryType::LineOfSight, count, 0.0f, 0.0f, 0.0f, 0, 0 };
+			if (!run(request, pairs.data(), &visibleMask[first / 32]))
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+public:
+	// A shared-memory query gives up once the server has made no progress on
+	// its slot for this long, or as soon as the server process is gone, and
+	// the client disconnects
+	int timeoutMilliseconds;
+private:
+	bool attachSharedMemory(const std::string &name)
+	{
+		int fd = shm_open(visibilityShmName(name).c_str(), O_RDWR, 0);
+		if (fd == -1)
+		{
+			return false;
+		}
+
+		struct stat info;
+		if (fstat(fd, &info) == -1 || info.st_size < (off_t)sizeof(SharedHeader))
+		{
+			close(fd);
+			return false;
+		}
+
+		m_mappedSize = info.st_size;
+		void *memory = mmap(nullptr, m_mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		close(fd);
+		if (memory == MAP_FAILED)
+		{
+			return false;
+		}
+
+		m_header = (SharedHeader *)memory;
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (m_header->magic != visibilityServiceMagic || m_header->version != visibilityServiceVersion || !isProcessAlive(m_header->serverPid))
+		{
+			munmap(m_header, m_mappedSize);
+			m_header = nullptr;
+			return false;
+		}
+
+		// Claim a free slot, or one whose owner process has died
+		for (unsigned int i = 0; i < m_header->numSlots; i++)
+		{
+			m_slot = i;
+			int owner = slot().owner.load();
+			if (owner != 0 && isProcessAlive(owner))
+			{
+				continue;
+			}
+
+			if (!slot().owner.compare_exchange_strong(owner, (int)getpid()))
+			{
+				continue;
+			}
+
+			// The previous owner may have left a request queued or running,
+			// which would still write into the arena
+			m_generation = slot().generation.fetch_add(1) + 1;
+
+			auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMilliseconds);
+			unsigned int progress = slot().progress.load(std::memory_order_relaxed);
+			int spins = 0;
+			while (slot().acknowledged.load(std::memory_order_acquire) != m_generation)
+			{
+				if (!wait(spins, progress, deadline))
+				{
+					return false;
+				}
+			}
+
+			// Completions an earlier owner never collected
+			QueryCompletion stale;
+			while (slot().completions.pop(stale))
+			{
+			}
+			return true;
+		}
+
+		munmap(m_header, m_mappedSize);
+		m_header = nullptr;
+		m_slot = -1;
+		return false;
+	}
+
+	SharedSlot &slot() const
+	{
+		return ((SharedSlot *)((char *)m_header + m_header->slotsOffset))[m_slot];
+	}
+
+	char *arena() const
+	{
+		return (char *)m_header + m_header->arenasOffset + m_slot * m_header->arenaSize;
+	}
+
+	// Spins, then sleeps; the deadline moves whenever the server reports
+	// progress on this slot. Disconnects once it passes or the server is
+	// gone, since the server may still write into the arena later
+	bool wait(int &spins, unsigned int &progress, std::chrono::steady_clock::time_point &deadline)
+	{
+		if (++spins <= 1000)
+		{
+			return true;
+		}
+
+		if (spins % 1000 == 0)
+		{
+			auto now = std::chrono::steady_clock::now();
+			unsigned int current = slot().progress.load(std::memory_order_relaxed);
+			if (current != progress)
+			{
+				progress = current;
+				deadline = now + std::chrono::milliseconds(timeoutMilliseconds);
+			}
+			else if (now > deadline || !isProcessAlive(m_header->serverPid))
+			{
+				disconnect();
+				return false;
+			}
+		}
+
+		std::this_thread::sleep_for(std::chrono::microseconds(20));
+		return true;
+	}
+
+	bool run(QueryRequest request, const void *input, void *output)
+	{
+		request.id = m_nextId++;
+		request.generation = m_generation;
+		size_t inputSize = queryInputSize(request);
+		size_t outputSize = queryOutputSize(request);
+
+		if (m_header)
+		{
+			if (inputSize + outputSize > m_header->arenaSize)
+			{
+				return false;
+			}
+
+			request.inputOffset = 0;
+			request.outputOffset = (inputSize + 63) & ~63ull;
+			if (request.outputOffset + outputSize > m_header->arenaSize)
+			{
+				request.outputOffset = inputSize;
+			}
+			if (inputSize > 0)
+			{
+				memcpy(arena(), input, inputSize);
+			}
+
+			auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMilliseconds);
+			unsigned int progress = slot().progress.load(std::memory_order_relaxed);
+			int spins = 0;
+			while (!slot().submissions.push(request))
+			{
+				if (!wait(spins, progress, deadline))
+				{
+					return false;
+				}
+			}
+
+			QueryCompletion completion;
+			spins = 0;
+			while (!slot().completions.pop(completion) || completion.generation != request.generation || completion.id != request.id)
+			{
+				if (!wait(spins, progress, deadline))
+				{
+					return false;
+				}
+			}
+
+			memcpy(output, arena() + request.outputOffset, outputSize);
+			return completion.status == 0;
+		}
+
+		if (m_socket == -1)
+		{
+			return false;
+		}
+
+		QueryCompletion completion;
+		if (!writeFully(m_socket, &request, sizeof(request)) || !writeFully(m_socket, input, inputSize) ||
+			!readFully(m_socket, &completion, sizeof(completion)) || !readFully(m_socket, output, outputSize))
+		{
+			return false;
+		}
+
+		return completion.status == 0;
+	}
+private:
+	SharedHeader *m_header;
+	size_t m_mappedSize;
+	int m_slot;
+	int m_socket;
+	unsigned int m_generation;
+	unsigned int m_nextId;
+};
+#endif